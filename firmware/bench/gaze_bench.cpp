@@ -0,0 +1,354 @@
+/**
+ * @file gaze_bench.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Closed-loop gaze accuracy and latency benchmark for the native host build.
+ * @version 1.0
+ *
+ * Feeds synthetic ToF targets through update_eye_positions(), renders every
+ * frame with the real draw_eye_at_target() into a framebuffer, locates the
+ * pupil in that framebuffer and compares where the eye looks with where the
+ * target is. For each configuration it reports steady-state angular error,
+ * settling time and overshoot, and exits with a non-zero status if any of
+ * them exceeds its limit. The render stage is also measured with the
+ * perf_counters API (Linux perf_event on the host): time, cycles,
+ * instructions and L1 read misses per frame. Finally, an idle saccade
+ * sequence is replayed through the frame cache to report its hit rate and
+ * the rendering time it saves.
+ *
+ * Run with: pio run -e native -t exec
+ * The strip and indexed-texture pipelines of boards without PSRAM are
+ * benchmarked with: pio run -e native-strip-indexed -t exec
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include <Arduino.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "config.h"
+#include "eye_logic.h"
+#include "eye_renderer.h"
+#include "frame_cache.h"
+#include "perf_counters.h"
+
+// --- Synthetic Eye Texture ---
+// Sclera, iris and a pupil drawn in a color used nowhere else, so the pupil
+// can be found exactly in the rendered framebuffer.
+const uint16_t SCLERA_COLOR = 0xFFFF;
+const uint16_t IRIS_COLOR = 0x2B5F;
+const uint16_t PUPIL_COLOR = 0x0841;
+const float SCLERA_RADIUS = 170.0f;
+const float IRIS_RADIUS = 70.0f;
+const float PUPIL_RADIUS = 30.0f;
+
+// --- Geometry ---
+// A normalized target of +/-1 is the center of an edge zone of the 8x8 grid,
+// 3.5 zones from the optical axis; each zone spans 45/8 degrees.
+const float DEG_PER_NORMALIZED_UNIT = 3.5f * (45.0f / 8.0f);
+
+// --- Benchmark Parameters ---
+const int WARMUP_FRAMES = 200; // Frames spent converging on the start position
+const int RUN_FRAMES = 90;     // Frames recorded after the step
+const int STEADY_STATE_FRAMES = 15; // Tail frames averaged for the steady-state error
+const float SETTLING_BAND_FRACTION = 0.02f; // Settled once within 2% of the step...
+const float SETTLING_BAND_MIN_PIXELS = 1.5f; // ...but never tighter than the integer-offset quantization
+
+// --- Pass/Fail Limits ---
+const float MAX_STEADY_ERROR_DEG = 0.55f; // Just above the floor set by truncating offsets to whole pixels on both axes
+const int MAX_SETTLING_FRAMES = 25;
+const float MAX_OVERSHOOT_PERCENT = 5.0f;
+
+// --- Frame Cache Replay ---
+const unsigned long IDLE_REPLAY_MS = 120000;     // Simulated idle time replayed through the cache
+const unsigned long IDLE_FRAME_PERIOD_MS = 33;   // 30 fps
+const unsigned long IDLE_RANDOM_SEED = 42;       // Same saccade sequence on every run
+
+struct GazeStep {
+    const char* name;
+    float start_x, start_y;
+    float target_x, target_y;
+};
+
+struct BenchConfig {
+    const char* name;
+    unsigned long frame_period_ms;
+    EyeImageType image_type;
+};
+
+// Render stage counters, summed over frames then averaged.
+struct RenderCost {
+    double time_us;
+    double cycles;
+    double instructions;
+    double l1d_misses;
+    double l1i_misses;
+};
+
+struct GazeResult {
+    bool pupil_found;
+    float steady_error_deg;
+    int settling_frames; // -1 if the eye never settled
+    float overshoot_percent;
+    RenderCost render;   // Average per frame for clear + draw_eye_at_target, all bands
+};
+
+static const GazeStep STEPS[] = {
+    {"center->right", 0.0f, 0.0f, 1.0f, 0.0f},
+    {"center->up", 0.0f, 0.0f, 0.0f, -1.0f},
+    {"center->diag", 0.0f, 0.0f, 0.5f, 0.5f},
+    {"corner->corner", -1.0f, -1.0f, 1.0f, 1.0f},
+    {"one zone", 0.0f, 0.0f, 1.0f / 3.5f, 0.0f},
+};
+
+static const BenchConfig CONFIGS[] = {
+    {"30 fps normal", 33, EYE_IMAGE_NORMAL},
+    {"15 fps bad", 66, EYE_IMAGE_BAD},
+    {"60 fps normal", 16, EYE_IMAGE_NORMAL},
+};
+
+/**
+ * @brief Builds the synthetic texture in the same RGB565 layout as the .bin assets.
+ */
+static uint16_t* build_synthetic_texture() {
+    uint16_t* texture = (uint16_t*)malloc(EYE_IMAGE_WIDTH * EYE_IMAGE_HEIGHT * sizeof(uint16_t));
+    const float cx = (EYE_IMAGE_WIDTH - 1) / 2.0f;
+    const float cy = (EYE_IMAGE_HEIGHT - 1) / 2.0f;
+    for (int y = 0; y < EYE_IMAGE_HEIGHT; y++) {
+        for (int x = 0; x < EYE_IMAGE_WIDTH; x++) {
+            float r = sqrtf((x - cx) * (x - cx) + (y - cy) * (y - cy));
+            uint16_t color = TRANSPARENT_COLOR_KEY;
+            if (r <= PUPIL_RADIUS) {
+                color = PUPIL_COLOR;
+            } else if (r <= IRIS_RADIUS) {
+                color = IRIS_COLOR;
+            } else if (r <= SCLERA_RADIUS) {
+                color = SCLERA_COLOR;
+            }
+            texture[y * EYE_IMAGE_WIDTH + x] = color;
+        }
+    }
+    return texture;
+}
+
+/**
+ * @brief Texture row reader over the synthetic texture in memory.
+ */
+static bool read_texture_rows_from_memory(void* context, int16_t first_row, int16_t count, uint16_t* out) {
+    const uint16_t* texture = (const uint16_t*)context;
+    memcpy(out, &texture[first_row * EYE_IMAGE_WIDTH], (size_t)count * EYE_IMAGE_WIDTH * sizeof(uint16_t));
+    return true;
+}
+
+// Whole rendered screen, assembled from the bands so the pupil can be located
+// the same way with full framebuffers and strips.
+static uint16_t screen_image[SCR_WD * SCR_HT];
+
+/**
+ * @brief Renders every band of the active screen and copies it into screen_image.
+ */
+static void render_screen(float x, float y, EyeImageType image_type) {
+    for (int16_t band_y = 0; band_y < SCR_HT; band_y += EYE_RENDER_BAND_LINES) {
+        int16_t lines = std::min(EYE_RENDER_BAND_LINES, SCR_HT - band_y);
+        set_render_band(band_y, lines);
+        clear_buffer(0x0000);
+        draw_eye_at_target(x, y, 0, image_type);
+        memcpy(&screen_image[band_y * SCR_WD], get_active_framebuffer(), (size_t)lines * SCR_WD * sizeof(uint16_t));
+    }
+}
+
+/**
+ * @brief Finds the pupil centroid in the rendered screen and converts it
+ * to the normalized gaze coordinates used by draw_eye_at_target().
+ * @return false if no pupil pixel is visible.
+ */
+static bool locate_gaze(float* gaze_x, float* gaze_y) {
+    const uint16_t* fb = screen_image;
+    const uint16_t pupil = swap_color_bytes(PUPIL_COLOR);
+    double sum_x = 0, sum_y = 0;
+    long count = 0;
+    for (int y = 0; y < SCR_HT; y++) {
+        for (int x = 0; x < SCR_WD; x++) {
+            if (fb[y * SCR_WD + x] == pupil) {
+                sum_x += x;
+                sum_y += y;
+                count++;
+            }
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    // The texture center lands on the screen center at rest
+    *gaze_x = ((float)(sum_x / count) - (SCR_WD - 1) / 2.0f) / MAX_2D_OFFSET_PIXELS;
+    *gaze_y = ((float)(sum_y / count) - (SCR_HT - 1) / 2.0f) / MAX_2D_OFFSET_PIXELS;
+    return true;
+}
+
+/**
+ * @brief Runs one pipeline frame: logic update, render, pupil measurement.
+ */
+static bool run_frame(const TofTarget& target, const BenchConfig& config, float* gaze_x, float* gaze_y, RenderCost* render) {
+    host_advance_millis(config.frame_period_ms);
+    update_eye_positions(target);
+    EyePosition pos = get_eye_position(EYE_LEFT);
+
+    // Called directly: the PERF_* macros compile away unless PERF_COUNTER_PROFILING is set
+    perf_stage_begin(PERF_STAGE_RENDER);
+    render_screen(pos.x, pos.y, config.image_type);
+    perf_stage_end(PERF_STAGE_RENDER);
+    perf_frame_end(false);
+
+    PerfCounters c = get_perf_stage_counters(PERF_STAGE_RENDER);
+    render->time_us += c.time_us;
+    render->cycles += c.cycles;
+    render->instructions += c.instructions;
+    render->l1d_misses += c.dcache_stalls;
+    render->l1i_misses += c.icache_stalls;
+
+    return locate_gaze(gaze_x, gaze_y);
+}
+
+/**
+ * @brief Converges on the start position, steps the target and measures the response.
+ */
+static GazeResult run_step(const GazeStep& step, const BenchConfig& config) {
+    GazeResult result = {true, 0.0f, -1, 0.0f, RenderCost{}};
+    TofTarget target = {step.start_x, step.start_y, 200, true, 3, 3, 0};
+    float gx, gy;
+    RenderCost render = {};
+
+    for (int i = 0; i < WARMUP_FRAMES; i++) {
+        run_frame(target, config, &gx, &gy, &render);
+    }
+
+    target.x = step.target_x;
+    target.y = step.target_y;
+    const float dx = step.target_x - step.start_x;
+    const float dy = step.target_y - step.start_y;
+    const float step_sq = dx * dx + dy * dy;
+    const float band = fmaxf(SETTLING_BAND_FRACTION * sqrtf(step_sq), SETTLING_BAND_MIN_PIXELS / MAX_2D_OFFSET_PIXELS);
+
+    std::vector<float> errors;
+    float max_progress = 0.0f;
+    render = RenderCost{};
+    for (int i = 0; i < RUN_FRAMES; i++) {
+        if (!run_frame(target, config, &gx, &gy, &render)) {
+            result.pupil_found = false;
+            return result;
+        }
+        float ex = gx - step.target_x;
+        float ey = gy - step.target_y;
+        errors.push_back(sqrtf(ex * ex + ey * ey));
+        // Progress along the step direction: 0 at the start, 1 on target
+        float progress = ((gx - step.start_x) * dx + (gy - step.start_y) * dy) / step_sq;
+        max_progress = fmaxf(max_progress, progress);
+    }
+    result.render = RenderCost{render.time_us / RUN_FRAMES, render.cycles / RUN_FRAMES,
+                               render.instructions / RUN_FRAMES, render.l1d_misses / RUN_FRAMES,
+                               render.l1i_misses / RUN_FRAMES};
+
+    // Settled at the first frame after which the error stays inside the band
+    for (int i = RUN_FRAMES - 1; i >= 0 && errors[i] <= band; i--) {
+        result.settling_frames = i;
+    }
+    double steady = 0.0;
+    for (int i = RUN_FRAMES - STEADY_STATE_FRAMES; i < RUN_FRAMES; i++) {
+        steady += errors[i];
+    }
+    result.steady_error_deg = steady / STEADY_STATE_FRAMES * DEG_PER_NORMALIZED_UNIT;
+    result.overshoot_percent = fmaxf(0.0f, max_progress - 1.0f) * 100.0f;
+    return result;
+}
+
+/**
+ * @brief Replays an idle saccade sequence on both screens through the frame
+ * cache, the way loop() draws without a ToF target, and prints its statistics.
+ */
+static void run_frame_cache_replay() {
+#if FRAME_CACHE_ENABLED
+    init_frame_cache();
+    randomSeed(IDLE_RANDOM_SEED);
+    const TofTarget no_target = {0.0f, 0.0f, 0, false, -1, -1, 0};
+    for (unsigned long t = 0; t < IDLE_REPLAY_MS; t += IDLE_FRAME_PERIOD_MS) {
+        host_advance_millis(IDLE_FRAME_PERIOD_MS);
+        update_eye_positions(no_target);
+        for (int i = 0; i < NUM_SCREEN; i++) {
+            set_active_framebuffer(i);
+            EyePosition pos = get_eye_position(i);
+            draw_eye_at_target_cached(pos.x, pos.y, 0, EYE_IMAGE_NORMAL, 0x0000, false);
+        }
+    }
+
+    FrameCacheStats c = get_frame_cache_stats();
+    uint32_t lookups = c.hits + c.misses;
+    float avg_render_us = c.misses > 0 ? (float)c.render_us / c.misses : 0.0f;
+    float saved_ms = (c.hits * avg_render_us - c.hit_us - c.store_us) / 1000.0f;
+    printf("Frame cache, %lu s idle replay: hit rate %.1f%% (%u hits, %u misses), %u stored, %u evicted, "
+           "render %.0f us, saved %.0f ms\n",
+           IDLE_REPLAY_MS / 1000, lookups > 0 ? 100.0f * c.hits / lookups : 0.0f, c.hits, c.misses,
+           c.insertions, c.evictions, avg_render_us, saved_ms);
+#else
+    printf("Frame cache: off with the strip pipeline\n");
+#endif
+}
+
+int main() {
+    for (int i = 0; i < NUM_SCREEN; i++) {
+        framebuffers[i] = (uint16_t*)malloc(SCR_WD * EYE_RENDER_BAND_LINES * sizeof(uint16_t));
+    }
+    uint16_t* texture = build_synthetic_texture();
+    for (int i = 0; i < NUM_EYE_IMAGE_TYPES; i++) {
+        if (!load_eye_texture((EyeImageType)i, read_texture_rows_from_memory, texture)) {
+            printf("Failed to load the synthetic texture\n");
+            return 1;
+        }
+    }
+    precalculate_scanlines();
+    set_active_framebuffer(EYE_LEFT);
+    init_perf_counters();
+
+    printf("Gaze benchmark: LERP_SPEED %.2f, MAX_2D_OFFSET_PIXELS %d, %.2f deg per normalized unit\n",
+           LERP_SPEED, MAX_2D_OFFSET_PIXELS, DEG_PER_NORMALIZED_UNIT);
+    printf("Pipeline: %s, %s textures\n", EYE_RENDER_STRIP ? "strip" : "full framebuffer",
+           EYE_TEXTURE_INDEXED ? "indexed" : "RGB565");
+    printf("Limits: steady error <= %.2f deg, settling <= %d frames, overshoot <= %.1f%%\n\n",
+           MAX_STEADY_ERROR_DEG, MAX_SETTLING_FRAMES, MAX_OVERSHOOT_PERCENT);
+    printf("%-14s %-16s %10s %9s %9s %10s %10s %11s %11s %9s %9s  %s\n",
+           "config", "step", "error_deg", "settle_f", "settle_ms", "overshoot", "render_us",
+           "cycles", "instr", "l1d_miss", "l1i_miss", "result");
+
+    int failures = 0;
+    for (const BenchConfig& config : CONFIGS) {
+        for (const GazeStep& step : STEPS) {
+            GazeResult r = run_step(step, config);
+            bool pass = r.pupil_found && r.settling_frames >= 0 &&
+                        r.steady_error_deg <= MAX_STEADY_ERROR_DEG &&
+                        r.settling_frames <= MAX_SETTLING_FRAMES &&
+                        r.overshoot_percent <= MAX_OVERSHOOT_PERCENT;
+            failures += !pass;
+
+            if (!r.pupil_found) {
+                printf("%-14s %-16s %s\n", config.name, step.name, "pupil not visible  FAIL");
+                continue;
+            }
+            printf("%-14s %-16s %10.3f %9d %9lu %9.1f%% %10.1f %11.0f %11.0f %9.0f %9.0f  %s\n",
+                   config.name, step.name, r.steady_error_deg, r.settling_frames,
+                   r.settling_frames >= 0 ? (r.settling_frames + 1) * config.frame_period_ms : 0UL,
+                   r.overshoot_percent, r.render.time_us, r.render.cycles, r.render.instructions,
+                   r.render.l1d_misses, r.render.l1i_misses, pass ? "ok" : "FAIL");
+        }
+    }
+
+    printf("\n%d configuration(s) out of limits\n\n", failures);
+    run_frame_cache_replay();
+    free(texture);
+    for (int i = 0; i < NUM_SCREEN; i++) {
+        free(framebuffers[i]);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file Arduino.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Minimal stand-in for the Arduino core used by the native host benchmarks.
+ * @version 1.0
+ *
+ * Only what the platform-independent modules (eye_logic, eye_renderer) call
+ * is provided. Time is simulated: the benchmark advances it explicitly so
+ * results do not depend on the speed of the host.
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+unsigned long millis();
+unsigned long micros();
+long random(long max_value);
+long random(long min_value, long max_value);
+void randomSeed(unsigned long seed);
+
+// Host-only: advances the simulated clock.
+void host_advance_millis(unsigned long ms);
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,43 @@
+/**
+ * @file host_arduino.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Simulated clock and random numbers for the native host benchmarks.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "Arduino.h"
+
+static unsigned long simulated_us = 0;
+static uint32_t random_state = 1;
+
+unsigned long millis() {
+    return simulated_us / 1000;
+}
+
+unsigned long micros() {
+    return simulated_us;
+}
+
+void host_advance_millis(unsigned long ms) {
+    simulated_us += ms * 1000;
+}
+
+void randomSeed(unsigned long seed) {
+    random_state = seed ? seed : 1;
+}
+
+long random(long max_value) {
+    // xorshift32: deterministic across hosts, unlike rand()
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return max_value > 0 ? (long)(random_state % (uint32_t)max_value) : 0;
+}
+
+long random(long min_value, long max_value) {
+    return max_value > min_value ? min_value + random(max_value - min_value) : min_value;
+}
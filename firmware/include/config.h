@@ -13,17 +13,28 @@
 #define CONFIG_H
 
 // --- Hardware & Pinout Configuration ---
+// Defaults match the ESP32-S3 board; other boards override them from platformio.ini.
+#ifndef PIN_CS1
 #define PIN_CS1 5 // Chip-select for screen 1
+#endif
+#ifndef PIN_CS2
 #define PIN_CS2 7 // Chip-select for screen 2
+#endif
 
 // --- ToF Sensor (VL53L5CX) Configuration ---
 #define USE_TOF_SENSOR 1 // Set to 1 to enable the ToF sensor, 0 to disable it.
 #define TOF_CALIBRATION_MODE 0 // Set to 1 to simulate sensor data for debugging.
 #define SHOW_TOF_DEBUG_GRID 1 // Set to 1 to display the debug grid, 0 to hide it
 
+#ifndef PIN_TOF_SCL
 #define PIN_TOF_SCL 15
+#endif
+#ifndef PIN_TOF_SDA
 #define PIN_TOF_SDA 16
+#endif
+#ifndef PIN_TOF_INT
 #define PIN_TOF_INT 17
+#endif
 
 // --- Display & Image Configuration ---
 #define SCR_WD 240 // Screen width in pixels
@@ -33,6 +44,41 @@
 #define EYE_IMAGE_HEIGHT 350
 const uint16_t TRANSPARENT_COLOR_KEY = 0x0000; // The color in assets treated as transparent (black).
 
+// --- Render Pipeline ---
+// Selected per board at compile time. Boards with PSRAM render each screen into a
+// full framebuffer and keep RGB565 textures. Boards without PSRAM render through one
+// small DMA-capable strip and store textures as 8-bit palette indices (~120 KB each
+// instead of 245 KB). platformio.ini may force either flag with -D.
+#ifndef EYE_RENDER_STRIP
+#if defined(ARDUINO) && !defined(BOARD_HAS_PSRAM)
+#define EYE_RENDER_STRIP 1
+#else
+#define EYE_RENDER_STRIP 0
+#endif
+#endif
+#ifndef EYE_TEXTURE_INDEXED
+#if defined(ARDUINO) && !defined(BOARD_HAS_PSRAM)
+#define EYE_TEXTURE_INDEXED 1
+#else
+#define EYE_TEXTURE_INDEXED 0
+#endif
+#endif
+#define EYE_STRIP_LINES 24 // Lines per strip in strip mode (10 strips per screen, 11.5 KB).
+#if EYE_RENDER_STRIP
+#define EYE_RENDER_BAND_LINES EYE_STRIP_LINES
+#else
+#define EYE_RENDER_BAND_LINES SCR_HT
+#endif
+const int16_t EYE_TEXTURE_CHUNK_ROWS = 25; // Rows per allocation (and per file read) of an indexed texture.
+
+// --- Frame Cache ---
+// Keeps fully rendered eye frames in PSRAM, keyed by pixel offset, texture and eyelid,
+// so an eye holding still or returning to a known pose is not re-rendered.
+// Requires full framebuffers: ignored when EYE_RENDER_STRIP is set.
+#define USE_FRAME_CACHE 1 // Set to 1 to enable the frame cache, 0 to disable it.
+const uint32_t FRAME_CACHE_BUDGET_BYTES = 2 * 1024 * 1024; // PSRAM for cached frames (115 KB each, ~18 frames).
+const unsigned long FRAME_CACHE_REPORT_INTERVAL_MS = 60000; // Interval of the hit-rate report.
+
 // --- Asset File Paths ---
 static const char* EYE_IMAGE_NORMAL_PATH = "/image_giant.bin"; // Image for random/idle mode
 static const char* EYE_IMAGE_BAD_PATH = "/image_giant_bad.bin"; // Image for tracking mode
@@ -48,6 +94,76 @@ const int RESTING_2D_OFFSET_PIXELS = (SCR_WD - EYE_IMAGE_WIDTH) / 2; // The "res
 
 // --- ToF Sensor Behavior ---
 const int MAX_DIST_TOF = 400; // Maximum distance in mm to consider a ToF target "close".
+const unsigned long TOF_STATS_INTERVAL_MS = 60000; // Interval of the sensor read/processing time report.
+const unsigned long TOF_FAULT_NO_FRAME_TIMEOUT_MS = 500; // No frame for this long (~7 ranging periods at 15 Hz) is a fault.
+const unsigned long TOF_FAULT_LOG_INTERVAL_MS = 10000;  // While a fault persists, it is logged at most once per interval.
+
+// Sensor-side motion indicator: the VL53L5CX computes per-zone motion itself and the
+// strongest moving zone is tracked when nothing is within MAX_DIST_TOF.
+// The driver only detects motion between 400 mm and 4000 mm, over a window of at most 1500 mm.
+#define TOF_USE_MOTION_INDICATOR 0 // Set to 1 to enable the motion indicator plugin.
+const int TOF_MOTION_MIN_DIST_MM = 400;   // Near edge of the motion detection window.
+const int TOF_MOTION_MAX_DIST_MM = 1900;  // Far edge of the motion detection window.
+const uint32_t TOF_MOTION_MIN_INDICATOR = 140; // Minimum aggregate motion value to be considered a target.
+
+// Sensor-side detection thresholds: the VL53L5CX raises PIN_TOF_INT only when a zone is
+// within MAX_DIST_TOF, and the MCU skips all I2C reads and processing until then.
+// Motion targets beyond MAX_DIST_TOF are not seen in this mode.
+#define TOF_USE_DETECTION_THRESHOLDS 0 // Set to 1 to wake on PIN_TOF_INT instead of polling the sensor.
+const int TOF_THRESHOLD_MIN_DIST_MM = 20; // Lower bound of the wake window; zones without a target read near 0 mm.
+const unsigned long TOF_THRESHOLD_RELEASE_MS = 250; // Drop the target after this long without an interrupt (~4 frames at 15 Hz).
+
+// --- Blink Reflex ---
+// A high-priority sensor task, woken by PIN_TOF_INT, checks every new frame for a fast
+// approach and closes both eyelids at once, preempting the frame being drawn or pushed.
+// The sensor is then read by that task instead of loop(). Requires the sensor's INT pin
+// wired to PIN_TOF_INT.
+#define USE_BLINK_REFLEX 0 // Set to 1 to enable the blink reflex.
+const int REFLEX_DIST_MM = 150;          // The closest zone must be nearer than this...
+const int REFLEX_MIN_SPEED_MM_S = 800;   // ...and have approached at least this fast since the previous frame.
+const unsigned long REFLEX_HOLD_MS = 400; // Time the eyelids stay closed.
+const uint16_t REFLEX_EYELID_COLOR = 0x6204; // RGB565 color of the closed eyelids.
+const int16_t REFLEX_PUSH_CHUNK_LINES = 40; // Frames are pushed in chunks of this many lines (~2 ms each at 80 MHz),
+                                            // the longest a reflex waits for the display.
+const unsigned long REFLEX_TASK_POLL_MS = 100; // The sensor task also polls this often if no interrupt arrives.
+const int REFLEX_TASK_PRIORITY = 5;      // Above loop() and the event log task.
+const int REFLEX_TASK_CORE = 0;          // loop() runs on core 1.
+// Flash writes stall both cores, so the event log defers them while a zone is closer than
+// REFLEX_ARM_DIST_MM, and for REFLEX_ARM_HOLD_MS after. A write can then only delay a reflex
+// if it started before the approach crossed REFLEX_ARM_DIST_MM (one batch append, up to
+// ~50 ms with a block erase), or after REFLEX_FLASH_MAX_DEFER_MS of deferral.
+const int REFLEX_ARM_DIST_MM = 600;
+const unsigned long REFLEX_ARM_HOLD_MS = 500;
+const unsigned long REFLEX_FLASH_MAX_DEFER_MS = 10000; // Past this, the log writes anyway rather than drop records.
+// Sensor interrupt to closed eyelids, with no flash write in progress: frame read over I2C
+// (~13 ms at 1 MHz) + one push chunk (~2 ms) + filling both screens at once (~12 ms).
+// Slower reflexes are reported.
+const uint32_t REFLEX_LATENCY_BUDGET_US = 30000;
+
+// --- Profiling ---
+// Samples hardware performance counters (cycles, instructions, cache-miss stalls)
+// around each stage of loop() and prints them per frame.
+#define PERF_COUNTER_PROFILING 0 // Set to 1 to enable per-stage counter sampling.
+const uint32_t PERF_COUNTER_REPORT_INTERVAL_FRAMES = 30; // Print one frame out of this many (1 = every frame).
+
+// --- Session Event Log (LittleFS) ---
+// Events are buffered in RAM and appended to flash in large batches by a background task.
+// Decode the log on a host with log_tools/decode_event_log.py.
+#define USE_EVENT_LOG 1         // Set to 1 to record session events to LittleFS, 0 to disable it.
+#define EVENT_LOG_BENCHMARK 0   // Set to 1 to measure LittleFS append throughput at boot.
+static const char* EVENT_LOG_PATH = "/events.bin";             // Current log file
+static const char* EVENT_LOG_ROTATED_PATH = "/events.old.bin"; // Previous log file, replaced on rotation
+const uint32_t EVENT_LOG_BATCH_BYTES = 4096;          // Size of each RAM batch (one LittleFS block).
+const uint32_t EVENT_LOG_MAX_FILE_BYTES = 256 * 1024; // Rotate the log file once it would exceed this size.
+// Flush a partially filled batch at least this often. Much longer than the FPS report interval,
+// so a quiet unit still writes batches of many records; full batches and the 'L' dump flush
+// sooner. Records still in RAM (up to this long) are lost on power loss.
+const unsigned long EVENT_LOG_FLUSH_INTERVAL_MS = 20UL * 60 * 1000;
+const int EVENT_LOG_TASK_PRIORITY = 1;  // Flush task priority (same as loop(), which runs on the other core).
+const int EVENT_LOG_TASK_CORE = 0;      // Flush task core; loop() runs on core 1.
+const int EVENT_LOG_BENCHMARK_BATCHES = 32;
+const unsigned long EVENT_LOG_FPS_REPORT_INTERVAL_MS = 60000; // Interval of the average-FPS record.
+const float EVENT_LOG_FPS_DIP_THRESHOLD = 20.0f; // A one-second FPS below this is recorded as a dip.
 
 
 
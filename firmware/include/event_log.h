@@ -0,0 +1,95 @@
+/**
+ * @file event_log.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Public interface for the batched session event log stored in LittleFS.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// --- Event Types ---
+// Stored as a single byte in each record. Append new types at the end so old
+// logs keep decoding (see log_tools/decode_event_log.py).
+enum EventType : uint8_t {
+    EVENT_BOOT = 0,          // value_a: reserved, value_b: free heap in bytes
+    EVENT_TARGET_ACQUIRED,   // value_a: distance in mm, value_b: zone index (row * 8 + column)
+    EVENT_TARGET_LOST,       // value_a: reserved, value_b: tracking duration in ms
+    EVENT_FPS_REPORT,        // value_a: FPS x10, value_b: frames in the interval
+    EVENT_FPS_DIP,           // value_a: FPS x10, value_b: dip threshold x10
+    EVENT_SENSOR_FAULT,      // value_a: fault code (see TofFaultCode), value_b: consecutive faults
+    EVENT_REFLEX,            // value_a: closest zone in mm, value_b: sensor interrupt to closed eyelids in us,
+                             //          or REFLEX_LATENCY_NOT_MEASURED for a polled frame
+    NUM_EVENT_TYPES
+};
+
+const int32_t REFLEX_LATENCY_NOT_MEASURED = -1; // EVENT_REFLEX value_b when no interrupt time was known
+
+// --- On-flash Format ---
+// A log file is a sequence of batches. Each batch is a header followed by
+// `record_count` fixed-size records. The magic lets the decoder resynchronise
+// after a batch torn by a power loss.
+#define EVENT_LOG_MAGIC   0x474C5645UL // "EVLG" in little-endian order
+#define EVENT_LOG_VERSION 1
+
+struct __attribute__((packed)) EventLogBatchHeader {
+    uint32_t magic;         // EVENT_LOG_MAGIC
+    uint8_t  version;       // EVENT_LOG_VERSION
+    uint8_t  record_size;   // sizeof(EventRecord), for forward compatibility
+    uint16_t record_count;  // Number of records following this header
+    uint32_t sequence;      // Batch counter, monotonically increasing across boots
+    uint32_t dropped;       // Records dropped since the previous batch (RAM buffer full)
+};
+
+struct __attribute__((packed)) EventRecord {
+    uint32_t timestamp_ms;  // millis() when the event was recorded
+    uint8_t  type;          // EventType
+    uint8_t  reserved;
+    int16_t  value_a;       // Type-specific payload, see EventType
+    int32_t  value_b;       // Type-specific payload, see EventType
+};
+
+// Write throughput statistics of the background flush task.
+struct EventLogStats {
+    uint32_t batches_written;
+    uint32_t bytes_written;
+    uint32_t write_time_us;  // Total time spent in file writes
+    uint32_t max_batch_us;   // Slowest single batch write
+    uint32_t records_dropped;
+    uint32_t rotations;
+};
+
+// Mounts nothing itself: LittleFS must already be started. Allocates the RAM
+// buffers and starts the background flush task. Call once in setup().
+void init_event_log();
+
+// Appends an event to the RAM buffer. Never touches flash; safe to call from
+// the render loop. Drops the record (and counts it) if both buffers are full.
+void log_event(EventType type, int16_t value_a = 0, int32_t value_b = 0);
+
+// Asks the flush task to write the partially filled buffer now.
+void request_event_log_flush();
+
+// Returns a snapshot of the write throughput statistics.
+EventLogStats get_event_log_stats();
+
+// Prints the write throughput statistics to the Serial monitor.
+void log_event_log_stats();
+
+// Streams the rotated and current log files to the Serial monitor as hex
+// lines framed by "EVENTLOG-BEGIN <path> <size>" / "EVENTLOG-END". Save the
+// monitor output and pass it to decode_event_log.py --capture.
+void dump_event_log();
+
+// Writes EVENT_LOG_BENCHMARK_BATCHES full batches to a scratch file and
+// reports the sustained write throughput. Blocking; only meant for setup().
+void benchmark_event_log_write();
+
+#endif // EVENT_LOG_H
@@ -12,8 +12,8 @@
 #ifndef EYE_LOGIC_H
 #define EYE_LOGIC_H
 
-#include "tof_sensor.h" // For TofTarget
-#include "drawing_tools.h" // For EyeImageType
+#include "tof_target.h" // For TofTarget
+#include "eye_renderer.h" // For EyeImageType and NUM_SCREEN
 
 // State for a single eye's logical position
 struct EyePosition {
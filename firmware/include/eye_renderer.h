@@ -0,0 +1,88 @@
+/**
+ * @file eye_renderer.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Platform-independent framebuffer rendering of the eye.
+ * @version 1.0
+ *
+ * Everything here only touches memory, so it builds both for the board and
+ * for the native host benchmarks (see bench/).
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef EYE_RENDERER_H
+#define EYE_RENDERER_H
+
+#include <stdint.h>
+#include "config.h"
+
+#define NUM_SCREEN 2
+
+// Enum to provide clear names for eye/screen indexing
+enum EyeIndex {
+    EYE_LEFT = 0,
+    EYE_RIGHT = 1
+};
+
+// --- Eye Asset Management ---
+// Enum to identify different eye image types
+enum EyeImageType {
+    EYE_IMAGE_NORMAL = 0, // Default image for random/idle mode
+    EYE_IMAGE_BAD,        // Image for tracking mode (e.g., "bad" or focused)
+    NUM_EYE_IMAGE_TYPES   // Total number of eye image types
+};
+
+// Holds the buffer for a single eye texture asset.
+#if EYE_TEXTURE_INDEXED
+// 8-bit palette indices, stored as row pointers into chunks of
+// EYE_TEXTURE_CHUNK_ROWS rows so that no single allocation needs a large
+// contiguous block. Index 0 is the transparent color key.
+struct EyeTexture {
+    uint8_t* rows[NUM_EYE_IMAGE_TYPES][EYE_IMAGE_HEIGHT];
+    uint16_t palettes[NUM_EYE_IMAGE_TYPES][256]; // Byte-swapped RGB565, ready for the framebuffer
+};
+#else
+struct EyeTexture {
+    uint16_t* buffers[NUM_EYE_IMAGE_TYPES]; // Array of pointers to image buffers
+};
+#endif
+extern EyeTexture eye_texture;
+
+// Reads `count` rows of RGB565 pixels starting at `first_row` into `out`.
+typedef bool (*TextureRowReader)(void* context, int16_t first_row, int16_t count, uint16_t* out);
+bool load_eye_texture(EyeImageType image_type, TextureRowReader reader, void* context);
+bool eye_texture_loaded(EyeImageType image_type);
+
+// --- Optimisation: Scanline pre-calculation for circular screen ---
+// Defines the start and end x-coordinates for a single horizontal line of a circle.
+struct Scanline {
+    int16_t x_start;
+    int16_t x_end;
+};
+extern Scanline circular_scanlines[SCR_HT];
+
+// Make framebuffers accessible to other files
+extern uint16_t* framebuffers[NUM_SCREEN];
+
+void set_active_framebuffer(int16_t ind);
+uint16_t* get_active_framebuffer();
+
+// The framebuffers hold EYE_RENDER_BAND_LINES screen lines. In strip mode a
+// frame is rendered one band at a time; otherwise the band is the whole screen.
+void set_render_band(int16_t first_line, int16_t line_count);
+int16_t get_render_band_start();
+int16_t get_render_band_lines();
+uint16_t* get_framebuffer_line(int16_t y);
+
+uint16_t swap_color_bytes(uint16_t color);
+void clear_buffer(uint16_t color);
+void precalculate_scanlines();
+
+void draw_eye_image(int16_t x_pos, int16_t y_pos, uint8_t eyelid_level, EyeImageType image_type);
+void get_eye_offset(float target_x, float target_y, int16_t* x_offset, int16_t* y_offset);
+void draw_eye_at_target(float target_x, float target_y, uint8_t eyelid_level, EyeImageType image_type);
+void draw_crosshair(int16_t center_x, int16_t center_y, int16_t size, uint16_t color);
+
+#endif // EYE_RENDERER_H
@@ -0,0 +1,74 @@
+/**
+ * @file frame_cache.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Memoized cache of fully rendered eye frames.
+ * @version 1.0
+ *
+ * A rendered eye only depends on its integer pixel offset, texture, eyelid
+ * level and any overlay baked into it. When the eye holds still or returns to
+ * a pose it already rendered, the frame is taken from the cache instead of
+ * re-sampling the texture: presented directly if nothing is drawn on top of
+ * it, otherwise copied into the framebuffer in one block.
+ *
+ * Frames live in PSRAM within FRAME_CACHE_BUDGET_BYTES and are evicted least
+ * recently used first. Only full framebuffers can be cached, so the cache is
+ * off in strip mode.
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "eye_renderer.h"
+
+#define FRAME_CACHE_ENABLED (USE_FRAME_CACHE && !EYE_RENDER_STRIP)
+
+// Overlay state of a cached frame. Overlays drawn after the eye (debug grid,
+// FPS counter) are not part of the cached frame and use FRAME_OVERLAY_NONE.
+const uint16_t FRAME_OVERLAY_NONE = 0;
+
+// Everything a cached frame depends on.
+struct FrameKey {
+    int16_t x_offset;      // Integer pixel offset of the eye from its resting position
+    int16_t y_offset;
+    uint8_t image_type;    // EyeImageType
+    uint8_t eyelid_level;
+    uint16_t overlay;      // Overlay baked into the frame, FRAME_OVERLAY_NONE if none
+};
+
+struct FrameCacheStats {
+    uint32_t frames;       // Frames held by the budget
+    uint32_t hits;
+    uint32_t direct_hits;  // Hits presented straight from the cache, without a copy
+    uint32_t misses;
+    uint32_t insertions;
+    uint32_t evictions;
+    uint64_t hit_us;       // Time spent serving hits (copies)
+    uint64_t render_us;    // Time spent rendering misses
+    uint64_t store_us;     // Time spent copying new frames into the cache
+};
+
+// Allocates as many frames as FRAME_CACHE_BUDGET_BYTES allows. Call after init_tft().
+void init_frame_cache();
+
+/**
+ * Draws the eye of the active screen for a normalized target, through the cache.
+ * @param background Color the framebuffer is cleared to before drawing the eye.
+ * @param needs_framebuffer True if more is drawn on top of the eye afterwards:
+ *        a hit is then copied into the active framebuffer.
+ * @return The frame to present: a cache entry, or the active framebuffer.
+ */
+const uint16_t* draw_eye_at_target_cached(float target_x, float target_y, uint8_t eyelid_level,
+                                          EyeImageType image_type, uint16_t background, bool needs_framebuffer);
+
+FrameCacheStats get_frame_cache_stats();
+
+// Prints the hit rate and time saved every FRAME_CACHE_REPORT_INTERVAL_MS.
+void log_frame_cache_stats_if_due();
+
+#endif // FRAME_CACHE_H
@@ -0,0 +1,70 @@
+/**
+ * @file perf_counters.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Hardware performance-counter sampling per pipeline stage.
+ * @version 1.0
+ *
+ * On the ESP32-S3 the counters come from the Xtensa performance monitor
+ * (instructions, data/instruction cache-miss stalls) and CCOUNT (cycles).
+ * On a Linux host the same API is backed by perf_event, where the cache
+ * figures are L1 miss counts rather than stall cycles.
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Pipeline stages of one frame of loop().
+enum PerfStage {
+    PERF_STAGE_SENSOR = 0, // update_tof_sensor_data()
+    PERF_STAGE_LOGIC,      // update_eye_positions()
+    PERF_STAGE_RENDER,     // Clearing and drawing both framebuffers
+    PERF_STAGE_PUSH,       // Pushing the framebuffers to the displays
+    NUM_PERF_STAGES
+};
+
+// Counter values for one stage over one frame. A stage entered several times
+// in a frame (e.g. once per screen) accumulates.
+struct PerfCounters {
+    uint32_t time_us;
+    uint32_t cycles;
+    uint32_t instructions;
+    uint32_t dcache_stalls; // ESP32-S3: D-cache miss stall cycles. Host: L1D read misses.
+    uint32_t icache_stalls; // ESP32-S3: I-cache miss stall cycles. Host: L1I read misses.
+};
+
+// Programs and starts the counters. Call once in setup(), on the core that runs loop().
+void init_perf_counters();
+
+// Brackets one pipeline stage.
+void perf_stage_begin(PerfStage stage);
+void perf_stage_end(PerfStage stage);
+
+// Closes the frame: publishes the per-stage counters and, if report is true,
+// prints them every PERF_COUNTER_REPORT_INTERVAL_FRAMES frames.
+void perf_frame_end(bool report = true);
+
+// Returns the counters of a stage for the last completed frame.
+PerfCounters get_perf_stage_counters(PerfStage stage);
+
+// Returns a short name for a stage ("sensor", "logic", ...).
+const char* get_perf_stage_name(PerfStage stage);
+
+// Stage brackets that compile away when PERF_COUNTER_PROFILING is 0.
+#if PERF_COUNTER_PROFILING
+#define PERF_STAGE_BEGIN(stage) perf_stage_begin(stage)
+#define PERF_STAGE_END(stage)   perf_stage_end(stage)
+#define PERF_FRAME_END()        perf_frame_end()
+#else
+#define PERF_STAGE_BEGIN(stage)
+#define PERF_STAGE_END(stage)
+#define PERF_FRAME_END()
+#endif
+
+#endif // PERF_COUNTERS_H
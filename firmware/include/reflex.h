@@ -0,0 +1,51 @@
+/**
+ * @file reflex.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Blink reflex: closes both eyelids as soon as something approaches fast.
+ * @version 1.0
+ *
+ * The sensor task (see tof_sensor.cpp) hands every new frame to
+ * reflex_on_sensor_frame(). On a fast approach closer than REFLEX_DIST_MM it
+ * raises the reflex, takes the display as soon as loop() releases it between
+ * two push chunks, and fills both screens with the eyelid color at once.
+ * loop() drops the frame in progress and sleeps until REFLEX_HOLD_MS has
+ * elapsed. The latency from the sensor interrupt to the closed eyelids is
+ * measured for every reflex.
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef REFLEX_H
+#define REFLEX_H
+
+#include <Arduino.h>
+#include <SparkFun_VL53L5CX_Library.h>
+#include "config.h"
+
+#define REFLEX_ENABLED (USE_BLINK_REFLEX && USE_TOF_SENSOR && !TOF_CALIBRATION_MODE)
+
+// Creates the display lock. Call in setup() before the sensor task starts.
+void init_reflex();
+
+// Checks a new sensor frame for a fast approach and presents the reflex if needed.
+// Called from the sensor task. frame_time_us is the micros() of the sensor interrupt,
+// or of the read for a polled frame (from_interrupt false), whose latency is not measured.
+void reflex_on_sensor_frame(const VL53L5CX_ResultsData* data, uint32_t frame_time_us, bool from_interrupt);
+
+// True while a reflex is pending or the eyelids are held closed: loop() must not draw.
+bool reflex_active();
+
+// Blocks the calling task until the reflex is over. Returns the time waited in ms.
+unsigned long reflex_wait_hold();
+
+// Flash writes stall both cores and would delay a reflex: call before writing to
+// flash. Waits while a zone is within REFLEX_ARM_DIST_MM, at most REFLEX_FLASH_MAX_DEFER_MS.
+void reflex_wait_flash_window();
+
+// Serializes display access between loop() and the reflex. Hold it for one push chunk at most.
+void reflex_display_lock();
+void reflex_display_unlock();
+
+#endif // REFLEX_H
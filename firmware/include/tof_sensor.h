@@ -20,16 +20,14 @@
 // Assurez-vous de l'installer via le gestionnaire de bibliothèques : "SparkFun VL53L5CX"
 #include <SparkFun_VL53L5CX_Library.h>
 
+#include "tof_target.h"
 
-// Structure pour stocker la position de la cible détectée par le ToF
-struct TofTarget {
-    float x; // Position horizontale (-1.0 à 1.0)
-    float y; // Position verticale (-1.0 à 1.0)
-    int distance_mm; // Distance en mm
-    bool is_valid; // Si une cible a été détectée
-    int8_t min_dist_pixel_x; // Coordonnée X du pixel le plus proche (pour débogage)
-    int8_t min_dist_pixel_y; // Coordonnée Y du pixel le plus proche (pour débogage)
-    long match_score; // Score de corrélation du template matching (pour débogage)
+
+// Fault codes recorded in the event log (EVENT_SENSOR_FAULT).
+enum TofFaultCode {
+    TOF_FAULT_READ_FAILED = 1, // getRangingData() returned an error
+    TOF_FAULT_NO_FRAME = 2,    // No frame for TOF_FAULT_NO_FRAME_TIMEOUT_MS (bus or sensor down)
+    TOF_FAULT_RECOVERED = 3,   // A frame was read again, value_b holds the faults of the episode
 };
 
 // Initializes the ToF sensor. Must be called in setup().
@@ -0,0 +1,28 @@
+/**
+ * @file tof_target.h
+ * @author Intellar (https://github.com/intellar)
+ * @brief Target description produced by the ToF sensor and consumed by the eye logic.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#ifndef TOF_TARGET_H
+#define TOF_TARGET_H
+
+#include <stdint.h>
+
+// Structure pour stocker la position de la cible détectée par le ToF
+struct TofTarget {
+    float x; // Position horizontale (-1.0 à 1.0)
+    float y; // Position verticale (-1.0 à 1.0)
+    int distance_mm; // Distance en mm
+    bool is_valid; // Si une cible a été détectée
+    int8_t min_dist_pixel_x; // Coordonnée X du pixel le plus proche (pour débogage)
+    int8_t min_dist_pixel_y; // Coordonnée Y du pixel le plus proche (pour débogage)
+    long match_score; // Score de corrélation du template matching (pour débogage)
+};
+
+#endif // TOF_TARGET_H
@@ -10,6 +10,7 @@
  *
  */
 #include "drawing_tools.h"
+#include "reflex.h"
 #include <Arduino.h>
 
 // TFT library
@@ -22,21 +23,11 @@ TFT_eSPI tft = TFT_eSPI();
 
 Screen screens[NUM_SCREEN]; // Definition for the screen configuration array
 
-// Framebuffers for off-screen drawing
-uint16_t* framebuffers[NUM_SCREEN];
-static int8_t active_screen_index = 0;
-
-// --- Image Buffer ---
-EyeTexture eye_texture; // Definition for the eye textures
-
 // --- Text Sprite ---
 TFT_eSprite spr = TFT_eSprite(&tft);
 
-// --- Optimisation: Scanline definition ---
-Scanline circular_scanlines[SCR_HT];
-
 // --- Forward Declarations for internal functions ---
-void pushSpriteToFb(TFT_eSprite* sprite, int32_t x, int32_t y, uint16_t* framebuffer, uint16_t transparent_color);
+void pushSpriteToFb(TFT_eSprite* sprite, int32_t x, int32_t y, uint16_t transparent_color);
 /**
  * @brief Logs the detailed setup and pin configuration of the TFT_eSPI library.
  * This is a helper function for debugging to confirm that the build flags
@@ -83,49 +74,59 @@ void log_tft_setup() {
 
 /**
  * @brief Selects the active screen for subsequent drawing operations.
+ * Drives the chip selects: once the sensor task runs, only call it under the
+ * display lock (see push_lines()), and use set_active_framebuffer() to draw.
  * @param ind The index of the screen to select (EYE_LEFT or EYE_RIGHT).
  */
 void select_screen(int16_t ind) {
   if (ind < 0 || ind >= NUM_SCREEN) return;
   digitalWrite(screens[EYE_LEFT].CS, (ind == EYE_LEFT) ? LOW : HIGH);
   digitalWrite(screens[EYE_RIGHT].CS, (ind == EYE_RIGHT) ? LOW : HIGH);
-  active_screen_index = ind;
+  set_active_framebuffer(ind);
 }
 /**
- * @brief Swaps the byte order of a 16-bit color value.
- * Required for compatibility between standard RGB565 and the display's byte order.
- * @param color The input color.
- * @return The color with bytes swapped.
+ * @brief Clears both physical screens to a specified color.
+ * @param color The 16-bit color to fill the screens with.
  */
-uint16_t swap_color_bytes(uint16_t color) {
-  return (color << 8) | (color >> 8);
+void clear_all_screens(uint16_t color) {
+  for (int i = 0; i < NUM_SCREEN; i++) {
+    select_screen(i);
+    tft.fillScreen(color);
+  }
 }
 
 /**
- * @brief Clears the active framebuffer to a specified color.
- * Uses an optimized `memset` for single-byte colors.
- * @param color The 16-bit color to clear the buffer with.
+ * @brief Pushes lines of a frame to a screen, one chunk of REFLEX_PUSH_CHUNK_LINES
+ * at a time under the display lock, so the blink reflex can take the display
+ * between two chunks. Gives up on the rest of the frame once a reflex is raised.
+ * @param ind The index of the screen to push to.
+ * @param y The first screen line.
+ * @param lines The number of lines.
+ * @param pixels The first line of pixels.
  */
-void clear_buffer(uint16_t color) {
-  uint16_t corrected_color = swap_color_bytes(color);
-  uint16_t* current_buffer = framebuffers[active_screen_index];
-  uint8_t hi = corrected_color >> 8, lo = corrected_color;
-  if (hi == lo) {
-    memset(current_buffer, lo, SCR_WD * SCR_HT * 2);
-  } else {
-    for (uint32_t i = 0; i < SCR_WD * SCR_HT; i++) current_buffer[i] = corrected_color;
+static void push_lines(int16_t ind, int16_t y, int16_t lines, const uint16_t* pixels) {
+  const int16_t chunk_lines = REFLEX_ENABLED ? REFLEX_PUSH_CHUNK_LINES : lines;
+  for (int16_t done = 0; done < lines; done += chunk_lines) {
+    if (reflex_active()) return; // The eyelids are closing: drop the rest of the frame
+    int16_t count = min(chunk_lines, (int16_t)(lines - done));
+    reflex_display_lock();
+    select_screen(ind); // Ensure correct screen is selected, the reflex selects both
+    tft.pushImage(0, y + done, SCR_WD, count, pixels + done * SCR_WD);
+    reflex_display_unlock();
   }
 }
 
 /**
- * @brief Clears both physical screens to a specified color.
- * @param color The 16-bit color to fill the screens with.
+ * @brief Fills both screens at once with both chip selects held low.
+ * Used by the blink reflex, which holds the display lock.
+ * @param color The 16-bit eyelid color.
  */
-void clear_all_screens(uint16_t color) {
-  for (int i = 0; i < NUM_SCREEN; i++) {
-    select_screen(i);
-    tft.fillScreen(color);
-  }
+void present_closed_eyelids(uint16_t color) {
+  digitalWrite(screens[EYE_LEFT].CS, LOW);
+  digitalWrite(screens[EYE_RIGHT].CS, LOW);
+  tft.fillScreen(color);
+  digitalWrite(screens[EYE_LEFT].CS, HIGH);
+  digitalWrite(screens[EYE_RIGHT].CS, HIGH);
 }
 
 /**
@@ -134,8 +135,27 @@ void clear_all_screens(uint16_t color) {
  */
 void display_buffer(int16_t ind) {
   if (ind < 0 || ind >= NUM_SCREEN) return;
-  select_screen(ind); // Ensure correct screen is selected
-  tft.pushImage(0, 0, SCR_WD, SCR_HT, framebuffers[ind]);
+  display_frame(ind, framebuffers[ind]);
+}
+
+/**
+ * @brief Pushes a full frame to a physical screen.
+ * @param ind The index of the screen to display on.
+ * @param frame The frame to push: a framebuffer or a cached frame.
+ */
+void display_frame(int16_t ind, const uint16_t* frame) {
+  if (ind < 0 || ind >= NUM_SCREEN) return;
+  push_lines(ind, 0, SCR_HT, frame);
+}
+
+/**
+ * @brief Pushes the current render band of a framebuffer to its screen.
+ * In strip mode this is how each strip reaches the display.
+ * @param ind The index of the screen/framebuffer to display.
+ */
+void display_band(int16_t ind) {
+  if (ind < 0 || ind >= NUM_SCREEN) return;
+  push_lines(ind, get_render_band_start(), get_render_band_lines(), framebuffers[ind]);
 }
 
 /**
@@ -147,39 +167,26 @@ void display_all_buffers() {
 }
 
 /**
- * @brief Pre-calculates the start and end x-coordinates for each horizontal
- * line of a circle that fits the screen. This is a major optimization for
- * circular drawing operations.
+ * @brief Texture row reader over an open LittleFS file.
  */
-void precalculate_scanlines() {
-    const int16_t screen_center = SCR_WD / 2;
-    const int32_t radius_sq = screen_center * screen_center;
-
-    for (int16_t y = 0; y < SCR_HT; y++) {
-        int32_t dist_y = y - screen_center;
-        int32_t dist_y_sq = dist_y * dist_y;
-        if (dist_y_sq < radius_sq) {
-            // Use integer square root for performance if available, otherwise float is fine for one-time setup
-            int16_t x_extent = sqrt(radius_sq - dist_y_sq);
-            circular_scanlines[y].x_start = screen_center - x_extent;
-            circular_scanlines[y].x_end = screen_center + x_extent;
-        } else {
-            circular_scanlines[y].x_start = -1; // Mark as not drawable
-            circular_scanlines[y].x_end = -1;
-        }
-    }
+static bool read_texture_rows_from_file(void* context, int16_t first_row, int16_t count, uint16_t* out) {
+    fs::File* file = (fs::File*)context;
+    size_t offset = (size_t)first_row * EYE_IMAGE_WIDTH * sizeof(uint16_t);
+    size_t size = (size_t)count * EYE_IMAGE_WIDTH * sizeof(uint16_t);
+    return file->seek(offset) && file->read((uint8_t*)out, size) == size;
 }
 
 /**
- * @brief Loads a binary image file from LittleFS into a specified buffer in PSRAM. 
- *        If PSRAM fails, it tries to allocate in internal RAM.
+ * @brief Loads a binary image file from LittleFS into an eye texture slot.
+ *        The texture goes to PSRAM when available, otherwise to internal RAM,
+ *        in the format selected by EYE_TEXTURE_INDEXED.
  * @param filename The path to the image file on LittleFS.
  * @param width The width of the image.
  * @param height The height of the image.
- * @param buffer A pointer to the buffer pointer that will store the image data.
+ * @param image_type The texture slot to fill.
  * @return true if the image was loaded successfully, false otherwise.
  */
-bool load_specific_eye_image(const char* filename, int16_t width, int16_t height, uint16_t** buffer) {
+bool load_specific_eye_image(const char* filename, int16_t width, int16_t height, EyeImageType image_type) {
     fs::File file = LittleFS.open(filename, "r");
     if (!file) {
         Serial.print("Failed to open file for reading: ");
@@ -196,23 +203,14 @@ bool load_specific_eye_image(const char* filename, int16_t width, int16_t height
         return false;
     }
     
-    // Allocate memory and read the file
-    *buffer = (uint16_t*)ps_malloc(file_size);
-    if (!*buffer) {
-        // If PSRAM allocation fails, try internal RAM as a fallback.
-        Serial.println("ps_malloc failed, trying malloc...");
-        *buffer = (uint16_t*)malloc(file_size);
-    }
-    if (!*buffer) { // If both allocations fail, report the error.
-        Serial.printf("Failed to allocate memory for eye image buffer: %s\n", filename);
-        file.close();
+    bool loaded = load_eye_texture(image_type, read_texture_rows_from_file, &file);
+    file.close();
+    if (!loaded) { // Allocation or read failed
+        Serial.printf("Failed to load eye image: %s (free heap %u)\n", filename, ESP.getFreeHeap());
         return false;
     }
     
-    file.read((uint8_t*)*buffer, file_size);
-    file.close();
-    
-    Serial.printf("Image '%s' loaded successfully into RAM.\n", filename);
+    Serial.printf("Image '%s' loaded successfully into RAM (%s).\n", filename, EYE_TEXTURE_INDEXED ? "indexed" : "RGB565");
     return true;
 }
 
@@ -240,12 +238,25 @@ void drawString_fb(const char *string, int32_t x, int32_t y, uint16_t fgcolor) {
     spr.setTextColor(fgcolor);
     spr.drawString(string, 0, 0); // Draw the text in the corner of the sprite
     // Copy the rendered text from the sprite to the active framebuffer.
-    pushSpriteToFb(&spr, x, y, framebuffers[active_screen_index], TFT_BLACK);
+    pushSpriteToFb(&spr, x, y, TFT_BLACK);
 }
 /**
  * @brief Initializes the TFT displays, framebuffers, and all graphical assets.
  */
 void init_tft() {
+#if EYE_RENDER_STRIP
+  // One strip in internal DMA-capable RAM, shared by both screens: each screen's
+  // band is pushed before the next one is drawn.
+  uint16_t* strip = (uint16_t*)heap_caps_malloc(SCR_WD * EYE_STRIP_LINES * sizeof(uint16_t), MALLOC_CAP_DMA);
+  if (strip == nullptr) {
+    Serial.println("FATAL: Failed to allocate render strip");
+    while(1); // Halt
+  }
+  for (int i = 0; i < NUM_SCREEN; i++) {
+    framebuffers[i] = strip;
+  }
+  Serial.printf("Render strip allocated (%d lines)\n", EYE_STRIP_LINES);
+#else
   // Allocate framebuffers in PSRAM
   for (int i = 0; i < NUM_SCREEN; i++) {
     framebuffers[i] = (uint16_t*)ps_malloc(SCR_WD * SCR_HT * sizeof(uint16_t));
@@ -255,6 +266,7 @@ void init_tft() {
     }
     Serial.printf("Framebuffer %d allocated in PSRAM\n", i);
   }
+#endif
 
   Serial.print("init tft ");
   screens[EYE_LEFT].CS = PIN_CS1;
@@ -282,130 +294,15 @@ void init_tft() {
   precalculate_scanlines(); // Fill our circular screen map
 
   // Load eye image from LittleFS
-  load_specific_eye_image(EYE_IMAGE_NORMAL_PATH, EYE_IMAGE_WIDTH, EYE_IMAGE_HEIGHT, &eye_texture.buffers[EYE_IMAGE_NORMAL]);
-  load_specific_eye_image(EYE_IMAGE_BAD_PATH, EYE_IMAGE_WIDTH, EYE_IMAGE_HEIGHT, &eye_texture.buffers[EYE_IMAGE_BAD]);
+  // Without room for the second image, the normal one is used for tracking too
+  load_specific_eye_image(EYE_IMAGE_NORMAL_PATH, EYE_IMAGE_WIDTH, EYE_IMAGE_HEIGHT, EYE_IMAGE_NORMAL);
+  load_specific_eye_image(EYE_IMAGE_BAD_PATH, EYE_IMAGE_WIDTH, EYE_IMAGE_HEIGHT, EYE_IMAGE_BAD);
 
   init_text_sprite();
 }
 
 // --- Image & Asset Management ---
 
-// --- Core Drawing & Rendering ---
-
-/**
- * @brief Draws the circular eye image with eyelid occlusion.
- * This is the main rendering function for the eye itself, using multiple
- * optimizations like pre-calculated scanlines and fixed-point math.
- * @param x_pos The x-coordinate of the top-left of the image.
- * @param y_pos The y-coordinate of the top-left of the image.
- * @param eyelid_level The current level of the eyelid (0=open).
- * @param image_type The type of eye image to draw (normal or bad).
- */
-void draw_eye_image(int16_t x_pos, int16_t y_pos, uint8_t eyelid_level, EyeImageType image_type) {
-  // If the image buffer has not been loaded, do nothing.
-  if (!eye_texture.buffers[image_type]) {
-    return;
-  }
-
-  const int16_t scaled_width = EYE_IMAGE_WIDTH;
-  const int16_t scaled_height = EYE_IMAGE_HEIGHT;
-
-  // Eyelid cutoff calculation
-  int16_t eyelid_y_cutoff = (eyelid_level / 128.0f) * (scaled_height / 2.0f);
-
-  // --- Fixed-point integer optimization ---
-  uint32_t src_y_accum = 0;
-  uint32_t src_increment = 1 * 65536; // Scale factor is implicitly 1.0
-
-  for (int16_t y = 0; y < scaled_height; y++) {
-    int16_t dest_y = y_pos + y;
-
-    // Skip lines that are off-screen or closed by the eyelid
-    if (dest_y < 0 || dest_y >= SCR_HT || y < eyelid_y_cutoff || y >= (scaled_height - eyelid_y_cutoff)) {
-      src_y_accum += src_increment;
-      continue;
-    }
-
-    // --- Using pre-calculated scanlines ---
-    int16_t x_start_visible = circular_scanlines[dest_y].x_start;
-    int16_t x_end_visible = circular_scanlines[dest_y].x_end;
-
-    // If the line is not visible, skip to the next one
-    if (x_start_visible == -1) {
-        src_y_accum += src_increment;
-        continue;
-    }
-
-    // Determine the actual drawing range, taking the image position into account
-    int16_t x_start_draw = max(x_start_visible, (int16_t)x_pos);
-    int16_t x_end_draw = min(x_end_visible, (int16_t)(x_pos + scaled_width));
-
-    int16_t src_y = src_y_accum >> 16;
-    uint16_t* source_line = &eye_texture.buffers[image_type][src_y * EYE_IMAGE_WIDTH]; // Calculate source line address once
-    uint16_t* framebuffer_line = &framebuffers[active_screen_index][(dest_y * SCR_WD)];
-    
-    // Initialize the X accumulator for the first visible coordinate
-    uint32_t src_x_accum = (x_start_draw - x_pos) * src_increment;
-
-    // Do not draw parts of the eye closed by the eyelid
-    for (int16_t dest_x = x_start_draw; dest_x < x_end_draw; dest_x++) {
-        int16_t src_x = src_x_accum >> 16;
-
-        uint16_t source_color = source_line[src_x]; // Read from the pre-calculated line
-        if (source_color == TRANSPARENT_COLOR_KEY) {
-            // Do nothing (the color key is transparent)
-        } else { // For all other colors
-            // Inline the drawPixel logic for performance
-            framebuffer_line[dest_x] = swap_color_bytes(source_color);
-        }
-        src_x_accum += src_increment; // Increment for the next pixel
-    }
-    src_y_accum += src_increment;
-  }
-}
-
-/**
- * @brief Draws the eye centered and looking at a normalized target coordinate.
- * This function simplifies the main loop logic by handling all position
- * calculations internally.
- * @param target_x The horizontal target, from -1.0 (left) to 1.0 (right).
- * @param target_y The vertical target, from -1.0 (up) to 1.0 (down).
- * @param eyelid_level The current level of the eyelid (0=open).
- * @param image_type The type of eye image to draw (normal or bad).
- */
-void draw_eye_at_target(float target_x, float target_y, uint8_t eyelid_level, EyeImageType image_type) {
-    // Calculate the final pixel offset based on the normalized target coordinates
-    int16_t x_offset = target_x * MAX_2D_OFFSET_PIXELS;
-    int16_t y_offset = target_y * MAX_2D_OFFSET_PIXELS;
-    draw_eye_image(RESTING_2D_OFFSET_PIXELS + x_offset, RESTING_2D_OFFSET_PIXELS + y_offset, eyelid_level, image_type);
-}
-
-/**
- * @brief Draws a simple crosshair at a given center point.
- * @param center_x The x-coordinate of the crosshair center.
- * @param center_y The y-coordinate of the crosshair center.
- * @param size The size of the crosshair arms.
- * @param color The 16-bit color of the crosshair.
- */
-void draw_crosshair(int16_t center_x, int16_t center_y, int16_t size, uint16_t color) {
-    uint16_t* current_buffer = framebuffers[active_screen_index];
-    uint16_t swapped_color = swap_color_bytes(color);
-
-    // Horizontal line
-    for (int16_t x = center_x - size; x <= center_x + size; ++x) {
-        if (x >= 0 && x < SCR_WD && center_y >= 0 && center_y < SCR_HT) {
-            current_buffer[center_y * SCR_WD + x] = swapped_color;
-        }
-    }
-
-    // Vertical line
-    for (int16_t y = center_y - size; y <= center_y + size; ++y) {
-        if (y >= 0 && y < SCR_HT && center_x >= 0 && center_x < SCR_WD) {
-            current_buffer[y * SCR_WD + center_x] = swapped_color;
-        }
-    }
-}
-
 /**
  * @brief Draws a debug grid representing the ToF sensor's 8x8 matrix.
  * @param x_pos The top-left x-coordinate of the grid on the screen.
@@ -416,7 +313,6 @@ void draw_crosshair(int16_t center_x, int16_t center_y, int16_t size, uint16_t c
 void draw_tof_debug_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const VL53L5CX_ResultsData* data, int8_t highlight_x, int8_t highlight_y) {
     if (!data) return;
 
-    uint16_t* current_buffer = framebuffers[active_screen_index];
     float cell_size = (float)grid_size / 8.0f;
 
     const int min_dist = 10;  // Distance en mm pour le noir
@@ -457,9 +353,10 @@ void draw_tof_debug_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const
             int16_t start_px = x_pos + cell_x * cell_size;
             int16_t start_py = y_pos + cell_y * cell_size;
             for (int py = start_py; py < start_py + cell_size; ++py) {
+                uint16_t* line = get_framebuffer_line(py); // nullptr outside the current band
                 for (int px = start_px; px < start_px + cell_size; ++px) {
-                    if (px >= 0 && px < SCR_WD && py >= 0 && py < SCR_HT) {
-                        current_buffer[py * SCR_WD + px] = color;
+                    if (px >= 0 && px < SCR_WD && line) {
+                        line[px] = color;
                     }
                 }
             }
@@ -477,7 +374,6 @@ void draw_tof_debug_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const
 void draw_score_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const long* scores, int8_t highlight_x, int8_t highlight_y) {
     if (!scores) return;
 
-    uint16_t* current_buffer = framebuffers[active_screen_index];
     float cell_size = (float)grid_size / 8.0f;
 
     // Trouver dynamiquement le min et max score pour normaliser les couleurs
@@ -530,9 +426,10 @@ void draw_score_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const long
             int16_t start_px = x_pos + cell_y * cell_size; // Use cell_y for horizontal position
             int16_t start_py = y_pos + cell_x * cell_size; // Use cell_x for vertical position
             for (int py = start_py; py < start_py + cell_size; ++py) {
+                uint16_t* line = get_framebuffer_line(py); // nullptr outside the current band
                 for (int px = start_px; px < start_px + cell_size; ++px) {
-                    if (px >= 0 && px < SCR_WD && py >= 0 && py < SCR_HT) {
-                        current_buffer[py * SCR_WD + px] = color;
+                    if (px >= 0 && px < SCR_WD && line) {
+                        line[px] = color;
                     }
                 }
             }
@@ -550,10 +447,9 @@ void draw_score_grid(int16_t x_pos, int16_t y_pos, int16_t grid_size, const long
  * @param sprite Pointer to the source sprite.
  * @param x Target x-coordinate in the framebuffer.
  * @param y Target y-coordinate in the framebuffer.
- * @param framebuffer Pointer to the destination framebuffer.
  * @param transparent_color The color in the sprite to treat as transparent.
  */
-void pushSpriteToFb(TFT_eSprite* sprite, int32_t x, int32_t y, uint16_t* framebuffer, uint16_t transparent_color) {
+void pushSpriteToFb(TFT_eSprite* sprite, int32_t x, int32_t y, uint16_t transparent_color) {
     uint16_t* sprite_buffer = (uint16_t*)sprite->getPointer();
     int16_t w = sprite->width();
     int16_t h = sprite->height();
@@ -561,10 +457,8 @@ void pushSpriteToFb(TFT_eSprite* sprite, int32_t x, int32_t y, uint16_t* framebu
     uint16_t transparent_color_swapped = swap_color_bytes(transparent_color);
 
     for (int16_t j = 0; j < h; j++) {
-        int32_t dest_y = y + j;
-        if (dest_y < 0 || dest_y >= SCR_HT) continue;
-
-        uint16_t* framebuffer_line = &framebuffer[dest_y * SCR_WD];
+        uint16_t* framebuffer_line = get_framebuffer_line(y + j); // Active framebuffer, current band
+        if (!framebuffer_line) continue;
         uint16_t* sprite_line = &sprite_buffer[j * w];
 
         for (int16_t i = 0; i < w; i++) {
@@ -604,15 +498,23 @@ void show_splash_screen() {
     int16_t x_pos = (SCR_WD - spr.width()) / 2; // Use spr.width() for robustness
     int16_t y_pos = (SCR_HT - spr.height()) / 2; // Use spr.height() which includes the descender margin
 
-    // Draw the splash screen to both framebuffers
-    for (int i = 0; i < NUM_SCREEN; i++) {
-        select_screen(i);
-        clear_buffer(bg_color);
-        pushSpriteToFb(&spr, x_pos, y_pos, framebuffers[i], bg_color);
+    // Draw the splash screen to both framebuffers, one band at a time
+    for (int16_t band_y = 0; band_y < SCR_HT; band_y += EYE_RENDER_BAND_LINES) {
+        set_render_band(band_y, min(EYE_RENDER_BAND_LINES, SCR_HT - band_y));
+        for (int i = 0; i < NUM_SCREEN; i++) {
+            set_active_framebuffer(i);
+            clear_buffer(bg_color);
+            pushSpriteToFb(&spr, x_pos, y_pos, bg_color);
+            #if EYE_RENDER_STRIP
+              display_band(i); // The strip is reused by the next screen
+            #endif
+        }
     }
 
     // Display on both screens and wait
-    display_all_buffers();
+    #if !EYE_RENDER_STRIP
+      display_all_buffers();
+    #endif
 
     // Clean up the large sprite to prevent it from interfering with other functions
     spr.deleteSprite();
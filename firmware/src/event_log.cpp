@@ -0,0 +1,373 @@
+/**
+ * @file event_log.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Implementation of the batched, append-only session event log.
+ * @version 1.0
+ *
+ * Records are appended to one of two RAM buffers. When a buffer is full (or
+ * the flush interval expires) it is handed to a low-priority background task
+ * that appends it to a LittleFS file in a single write, so loop() never waits
+ * on the file system in code. A flash program or erase still disables the
+ * cache on both cores: each batch write pauses rendering for up to
+ * max_batch_us, reported by log_event_log_stats(). With the blink reflex,
+ * writes are deferred while something is close (see reflex_wait_flash_window()).
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "event_log.h"
+#include "LittleFS.h"
+#include "reflex.h"
+
+#if USE_EVENT_LOG
+
+// Each RAM buffer holds a batch header followed by as many records as fit.
+static const uint16_t RECORDS_PER_BATCH = (EVENT_LOG_BATCH_BYTES - sizeof(EventLogBatchHeader)) / sizeof(EventRecord);
+static const size_t BATCH_CAPACITY_BYTES = sizeof(EventLogBatchHeader) + RECORDS_PER_BATCH * sizeof(EventRecord);
+
+// --- Module-Private State ---
+static uint8_t* batch_buffers[2] = {nullptr, nullptr};
+static uint16_t batch_fill[2] = {0, 0};  // Records in each buffer
+static bool batch_pending[2] = {false, false}; // True while a buffer waits for (or is in) a flash write
+static uint8_t active_batch = 0;         // Buffer currently receiving records
+static uint32_t records_dropped_since_flush = 0;
+static uint32_t next_sequence = 0;
+
+static EventLogStats stats = {};
+static TaskHandle_t flush_task_handle = nullptr;
+static portMUX_TYPE log_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Returns a pointer to the first record slot of a batch buffer.
+ */
+static EventRecord* batch_records(uint8_t index) {
+    return reinterpret_cast<EventRecord*>(batch_buffers[index] + sizeof(EventLogBatchHeader));
+}
+
+/**
+ * @brief Finds the sequence number to continue from by walking the batch
+ * headers of the existing log file. Stops at the first corrupt header.
+ */
+static uint32_t find_next_sequence() {
+    fs::File file = LittleFS.open(EVENT_LOG_PATH, "r");
+    if (!file) {
+        return 0;
+    }
+
+    uint32_t next = 0;
+    EventLogBatchHeader header;
+    while (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) {
+        if (header.magic != EVENT_LOG_MAGIC || header.record_size != sizeof(EventRecord)) {
+            break;
+        }
+        next = header.sequence + 1;
+        if (!file.seek(file.position() + (size_t)header.record_count * header.record_size)) {
+            break;
+        }
+    }
+    file.close();
+    return next;
+}
+
+/**
+ * @brief Keeps the log file below EVENT_LOG_MAX_FILE_BYTES by moving it to
+ * EVENT_LOG_ROTATED_PATH (replacing the previous rotated file).
+ * @param incoming_bytes The size of the batch about to be appended.
+ */
+static void rotate_log_if_needed(size_t incoming_bytes) {
+    fs::File file = LittleFS.open(EVENT_LOG_PATH, "r");
+    if (!file) {
+        return;
+    }
+    size_t current_size = file.size();
+    file.close();
+
+    if (current_size + incoming_bytes <= EVENT_LOG_MAX_FILE_BYTES) {
+        return;
+    }
+    if (LittleFS.exists(EVENT_LOG_ROTATED_PATH)) {
+        LittleFS.remove(EVENT_LOG_ROTATED_PATH);
+    }
+    LittleFS.rename(EVENT_LOG_PATH, EVENT_LOG_ROTATED_PATH);
+
+    portENTER_CRITICAL(&log_mux);
+    stats.rotations++;
+    portEXIT_CRITICAL(&log_mux);
+}
+
+/**
+ * @brief Appends one batch buffer to the log file in a single write.
+ * @param index The batch buffer to write.
+ * @param record_count Number of records in the buffer.
+ * @param dropped Records dropped before this batch was sealed.
+ * @return false if the log file could not be opened and nothing was written.
+ */
+static bool write_batch(uint8_t index, uint16_t record_count, uint32_t dropped) {
+    EventLogBatchHeader* header = reinterpret_cast<EventLogBatchHeader*>(batch_buffers[index]);
+    header->magic = EVENT_LOG_MAGIC;
+    header->version = EVENT_LOG_VERSION;
+    header->record_size = sizeof(EventRecord);
+    header->record_count = record_count;
+    header->sequence = next_sequence;
+    header->dropped = dropped;
+
+    size_t batch_bytes = sizeof(EventLogBatchHeader) + record_count * sizeof(EventRecord);
+    rotate_log_if_needed(batch_bytes);
+
+    unsigned long start_us = micros();
+    fs::File file = LittleFS.open(EVENT_LOG_PATH, "a");
+    if (!file) {
+        Serial.println("EventLog: failed to open log file for append.");
+        return false;
+    }
+    next_sequence++;
+    size_t written = file.write(batch_buffers[index], batch_bytes);
+    file.close(); // Commits the batch to flash
+    unsigned long elapsed_us = micros() - start_us;
+
+    portENTER_CRITICAL(&log_mux);
+    stats.batches_written++;
+    stats.bytes_written += written;
+    stats.write_time_us += elapsed_us;
+    if (elapsed_us > stats.max_batch_us) {
+        stats.max_batch_us = elapsed_us;
+    }
+    portEXIT_CRITICAL(&log_mux);
+    return true;
+}
+
+/**
+ * @brief Background task that writes sealed batches to flash. Wakes up when
+ * a buffer fills, when a flush is requested, or every EVENT_LOG_FLUSH_INTERVAL_MS.
+ */
+static void event_log_task(void* parameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EVENT_LOG_FLUSH_INTERVAL_MS));
+
+        // Seal the active buffer if it holds anything and the other one is free,
+        // so a quiet unit still lands its records on a regular schedule.
+        portENTER_CRITICAL(&log_mux);
+        uint8_t other = active_batch ^ 1;
+        if (batch_fill[active_batch] > 0 && !batch_pending[active_batch] && !batch_pending[other]) {
+            batch_pending[active_batch] = true;
+            active_batch = other;
+        }
+        // The buffer not receiving records was sealed first: write it first.
+        uint8_t oldest = active_batch ^ 1;
+        portEXIT_CRITICAL(&log_mux);
+
+        for (uint8_t n = 0; n < 2; n++) {
+            uint8_t i = oldest ^ n;
+            portENTER_CRITICAL(&log_mux);
+            bool pending = batch_pending[i];
+            uint16_t record_count = batch_fill[i];
+            uint32_t dropped = records_dropped_since_flush;
+            if (pending) {
+                records_dropped_since_flush = 0;
+            }
+            portEXIT_CRITICAL(&log_mux);
+
+            if (!pending) {
+                continue;
+            }
+            if (record_count > 0) {
+                reflex_wait_flash_window(); // Keeps flash writes out of the blink reflex latency
+                if (!write_batch(i, record_count, dropped)) {
+                    // Report the lost records, and the drops this header carried, in the next batch header
+                    portENTER_CRITICAL(&log_mux);
+                    records_dropped_since_flush += record_count + dropped;
+                    stats.records_dropped += record_count;
+                    portEXIT_CRITICAL(&log_mux);
+                }
+            }
+
+            portENTER_CRITICAL(&log_mux);
+            batch_fill[i] = 0;
+            batch_pending[i] = false;
+            portEXIT_CRITICAL(&log_mux);
+        }
+    }
+}
+
+/**
+ * @brief Allocates the RAM buffers and starts the background flush task.
+ */
+void init_event_log() {
+    for (int i = 0; i < 2; i++) {
+        batch_buffers[i] = (uint8_t*)malloc(BATCH_CAPACITY_BYTES);
+        if (!batch_buffers[i]) {
+            Serial.println("EventLog: failed to allocate batch buffers. Logging disabled.");
+            free(batch_buffers[0]); // Either still null or the first buffer
+            batch_buffers[0] = nullptr;
+            return;
+        }
+    }
+
+    next_sequence = find_next_sequence();
+
+    xTaskCreatePinnedToCore(event_log_task, "event_log", 4096, nullptr,
+                            EVENT_LOG_TASK_PRIORITY, &flush_task_handle, EVENT_LOG_TASK_CORE);
+
+    Serial.printf("EventLog: %u records per batch, continuing at batch %u.\n",
+                  RECORDS_PER_BATCH, next_sequence);
+}
+
+/**
+ * @brief Appends an event to the active RAM buffer.
+ * @param type The event type.
+ * @param value_a First type-specific payload value.
+ * @param value_b Second type-specific payload value.
+ */
+void log_event(EventType type, int16_t value_a, int32_t value_b) {
+    if (!flush_task_handle) {
+        return;
+    }
+
+    bool wake_flush_task = false;
+    portENTER_CRITICAL(&log_mux);
+    uint8_t index = active_batch;
+    if (batch_pending[index] && !batch_pending[index ^ 1]) {
+        // The flush task has freed the other buffer since this one was sealed.
+        index ^= 1;
+        active_batch = index;
+    }
+    if (batch_pending[index]) {
+        // Both buffers are waiting on flash: drop rather than block rendering.
+        records_dropped_since_flush++;
+        stats.records_dropped++;
+    } else {
+        EventRecord& record = batch_records(index)[batch_fill[index]++];
+        record.timestamp_ms = millis();
+        record.type = type;
+        record.reserved = 0;
+        record.value_a = value_a;
+        record.value_b = value_b;
+
+        if (batch_fill[index] >= RECORDS_PER_BATCH) {
+            // Seal the full buffer and switch to the other one if it is free.
+            batch_pending[index] = true;
+            if (!batch_pending[index ^ 1]) {
+                active_batch = index ^ 1;
+            }
+            wake_flush_task = true;
+        }
+    }
+    portEXIT_CRITICAL(&log_mux);
+
+    if (wake_flush_task) {
+        xTaskNotifyGive(flush_task_handle);
+    }
+}
+
+void request_event_log_flush() {
+    if (flush_task_handle) {
+        xTaskNotifyGive(flush_task_handle);
+    }
+}
+
+EventLogStats get_event_log_stats() {
+    portENTER_CRITICAL(&log_mux);
+    EventLogStats snapshot = stats;
+    portEXIT_CRITICAL(&log_mux);
+    return snapshot;
+}
+
+/**
+ * @brief Prints the write throughput statistics to the Serial monitor.
+ */
+void log_event_log_stats() {
+    EventLogStats s = get_event_log_stats();
+    float kb_per_s = s.write_time_us > 0 ? (s.bytes_written / 1024.0f) / (s.write_time_us / 1000000.0f) : 0.0f;
+    Serial.printf("EventLog: %u batches, %u B, %.1f KB/s, slowest batch %.2f ms, %u dropped, %u rotations\n",
+                  s.batches_written, s.bytes_written, kb_per_s, s.max_batch_us / 1000.0f,
+                  s.records_dropped, s.rotations);
+}
+
+/**
+ * @brief Streams one log file to the Serial monitor as framed hex lines.
+ * @param path The file to dump.
+ */
+static void dump_log_file(const char* path) {
+    fs::File file = LittleFS.open(path, "r");
+    if (!file) {
+        return;
+    }
+    Serial.printf("EVENTLOG-BEGIN %s %u\n", path, (unsigned)file.size());
+    uint8_t chunk[32];
+    size_t count;
+    while ((count = file.read(chunk, sizeof(chunk))) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            Serial.printf("%02X", chunk[i]);
+        }
+        Serial.println();
+    }
+    Serial.println("EVENTLOG-END");
+    file.close();
+}
+
+/**
+ * @brief Flushes pending records, then dumps the rotated and current log files.
+ */
+void dump_event_log() {
+    request_event_log_flush();
+    delay(200); // Give the flush task time to land the partial batch
+    dump_log_file(EVENT_LOG_ROTATED_PATH);
+    dump_log_file(EVENT_LOG_PATH);
+}
+
+/**
+ * @brief Measures sustained LittleFS append throughput with full-size batches.
+ * Uses the same open/append/close pattern as the flush task.
+ */
+void benchmark_event_log_write() {
+    const char* bench_path = "/evbench.bin";
+    uint8_t* buffer = (uint8_t*)malloc(BATCH_CAPACITY_BYTES);
+    if (!buffer) {
+        Serial.println("EventLog benchmark: allocation failed.");
+        return;
+    }
+    memset(buffer, 0xA5, BATCH_CAPACITY_BYTES);
+    LittleFS.remove(bench_path);
+
+    unsigned long total_us = 0;
+    unsigned long max_us = 0;
+    size_t total_bytes = 0;
+    for (int i = 0; i < EVENT_LOG_BENCHMARK_BATCHES; i++) {
+        unsigned long start_us = micros();
+        fs::File file = LittleFS.open(bench_path, "a");
+        if (!file) {
+            Serial.println("EventLog benchmark: failed to open scratch file.");
+            break;
+        }
+        total_bytes += file.write(buffer, BATCH_CAPACITY_BYTES);
+        file.close();
+        unsigned long elapsed_us = micros() - start_us;
+        total_us += elapsed_us;
+        if (elapsed_us > max_us) {
+            max_us = elapsed_us;
+        }
+    }
+
+    LittleFS.remove(bench_path);
+    free(buffer);
+
+    float kb_per_s = total_us > 0 ? (total_bytes / 1024.0f) / (total_us / 1000000.0f) : 0.0f;
+    Serial.printf("EventLog benchmark: %u B in %lu us (%.1f KB/s), batch avg %.2f ms, max %.2f ms\n",
+                  (unsigned)total_bytes, total_us, kb_per_s,
+                  total_us / 1000.0f / EVENT_LOG_BENCHMARK_BATCHES, max_us / 1000.0f);
+}
+
+#else // If USE_EVENT_LOG is 0
+
+// Provide empty functions so the program compiles without the event log.
+void init_event_log() { /* Does nothing */ }
+void log_event(EventType type, int16_t value_a, int32_t value_b) { /* Does nothing */ }
+void request_event_log_flush() { /* Does nothing */ }
+EventLogStats get_event_log_stats() { return {}; }
+void log_event_log_stats() { /* Does nothing */ }
+void dump_event_log() { /* Does nothing */ }
+void benchmark_event_log_write() { /* Does nothing */ }
+
+#endif
@@ -0,0 +1,460 @@
+/**
+ * @file eye_renderer.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Implementation of the platform-independent framebuffer rendering.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "eye_renderer.h"
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(ARDUINO)
+#include <Arduino.h> // For ps_malloc
+#endif
+
+// --- Global Variables ---
+
+// Framebuffers for off-screen drawing
+uint16_t* framebuffers[NUM_SCREEN];
+static int8_t active_screen_index = 0;
+
+// Screen lines held by the framebuffers: the whole screen, or one strip when
+// EYE_RENDER_STRIP is set. Drawing outside the band is clipped.
+static int16_t band_first_line = 0;
+static int16_t band_line_count = EYE_RENDER_BAND_LINES;
+
+// --- Image Buffer ---
+EyeTexture eye_texture; // Definition for the eye textures
+
+// --- Optimisation: Scanline definition ---
+Scanline circular_scanlines[SCR_HT];
+
+// --- Framebuffer Management ---
+
+/**
+ * @brief Selects the framebuffer used by subsequent drawing operations.
+ * @param ind The index of the framebuffer (EYE_LEFT or EYE_RIGHT).
+ */
+void set_active_framebuffer(int16_t ind) {
+  if (ind < 0 || ind >= NUM_SCREEN) return;
+  active_screen_index = ind;
+}
+
+/**
+ * @brief Returns the framebuffer used by drawing operations.
+ */
+uint16_t* get_active_framebuffer() {
+  return framebuffers[active_screen_index];
+}
+
+/**
+ * @brief Selects the screen lines that the framebuffers currently hold.
+ * @param first_line The screen line stored at the start of the framebuffer.
+ * @param line_count The number of lines, at most EYE_RENDER_BAND_LINES.
+ */
+void set_render_band(int16_t first_line, int16_t line_count) {
+  band_first_line = first_line;
+  band_line_count = std::min<int16_t>(line_count, EYE_RENDER_BAND_LINES);
+}
+
+int16_t get_render_band_start() {
+  return band_first_line;
+}
+
+int16_t get_render_band_lines() {
+  return band_line_count;
+}
+
+/**
+ * @brief Returns the start of a screen line in the active framebuffer.
+ * @param y The screen line.
+ * @return A pointer to the line, or nullptr if it is outside the current band.
+ */
+uint16_t* get_framebuffer_line(int16_t y) {
+  if (y < band_first_line || y >= band_first_line + band_line_count) {
+    return nullptr;
+  }
+  return &framebuffers[active_screen_index][(y - band_first_line) * SCR_WD];
+}
+
+/**
+ * @brief Swaps the byte order of a 16-bit color value.
+ * Required for compatibility between standard RGB565 and the display's byte order.
+ * @param color The input color.
+ * @return The color with bytes swapped.
+ */
+uint16_t swap_color_bytes(uint16_t color) {
+  return (color << 8) | (color >> 8);
+}
+
+/**
+ * @brief Clears the active framebuffer (the lines of the current band) to a specified color.
+ * Uses an optimized `memset` for single-byte colors.
+ * @param color The 16-bit color to clear the buffer with.
+ */
+void clear_buffer(uint16_t color) {
+  uint16_t corrected_color = swap_color_bytes(color);
+  uint16_t* current_buffer = framebuffers[active_screen_index];
+  uint32_t pixel_count = (uint32_t)SCR_WD * band_line_count;
+  uint8_t hi = corrected_color >> 8, lo = corrected_color;
+  if (hi == lo) {
+    memset(current_buffer, lo, pixel_count * 2);
+  } else {
+    for (uint32_t i = 0; i < pixel_count; i++) current_buffer[i] = corrected_color;
+  }
+}
+
+/**
+ * @brief Pre-calculates the start and end x-coordinates for each horizontal
+ * line of a circle that fits the screen. This is a major optimization for
+ * circular drawing operations.
+ */
+void precalculate_scanlines() {
+    const int16_t screen_center = SCR_WD / 2;
+    const int32_t radius_sq = screen_center * screen_center;
+
+    for (int16_t y = 0; y < SCR_HT; y++) {
+        int32_t dist_y = y - screen_center;
+        int32_t dist_y_sq = dist_y * dist_y;
+        if (dist_y_sq < radius_sq) {
+            // Use integer square root for performance if available, otherwise float is fine for one-time setup
+            int16_t x_extent = sqrt(radius_sq - dist_y_sq);
+            circular_scanlines[y].x_start = screen_center - x_extent;
+            circular_scanlines[y].x_end = screen_center + x_extent;
+        } else {
+            circular_scanlines[y].x_start = -1; // Mark as not drawable
+            circular_scanlines[y].x_end = -1;
+        }
+    }
+}
+
+// --- Texture Loading ---
+
+/**
+ * @brief Allocates texture memory, preferring PSRAM when the board has it.
+ */
+static void* alloc_texture_memory(size_t size) {
+#if defined(ARDUINO)
+  void* memory = ps_malloc(size);
+  if (memory) {
+    return memory;
+  }
+#endif
+  return malloc(size);
+}
+
+bool eye_texture_loaded(EyeImageType image_type) {
+#if EYE_TEXTURE_INDEXED
+  return eye_texture.rows[image_type][0] != nullptr;
+#else
+  return eye_texture.buffers[image_type] != nullptr;
+#endif
+}
+
+#if EYE_TEXTURE_INDEXED
+// Histogram buckets are RGB444: 4096 buckets, each represented by the first
+// RGB565 color that falls into it.
+static const int PALETTE_BUCKETS = 4096;
+
+struct PaletteBuilder {
+  uint32_t counts[PALETTE_BUCKETS];          // Opaque pixels per bucket
+  uint16_t representative[PALETTE_BUCKETS];  // First RGB565 color seen in each bucket
+  uint8_t lut[PALETTE_BUCKETS];              // Bucket -> palette index
+};
+
+static inline uint16_t palette_bucket(uint16_t color) {
+  return ((color >> 12) << 8) | (((color >> 7) & 0x0F) << 4) | ((color >> 1) & 0x0F);
+}
+
+/**
+ * @brief Squared distance between two RGB565 colors, with red and blue
+ * scaled to the 6-bit range of green.
+ */
+static uint32_t color_distance(uint16_t a, uint16_t b) {
+  int32_t dr = (int32_t)((a >> 11) - (b >> 11)) * 2;
+  int32_t dg = (int32_t)((a >> 5) & 0x3F) - (int32_t)((b >> 5) & 0x3F);
+  int32_t db = (int32_t)((a & 0x1F) - (b & 0x1F)) * 2;
+  return dr * dr + dg * dg + db * db;
+}
+
+/**
+ * @brief Picks the 255 most used buckets as the palette (index 0 stays
+ * transparent) and maps every other used bucket to its nearest entry.
+ * @param palette Receives the byte-swapped palette, ready for the framebuffer.
+ */
+static void build_palette(PaletteBuilder* pb, uint16_t* palette) {
+  uint16_t raw_palette[256] = {0};
+  int colors = 1;
+  for (; colors < 256; colors++) {
+    int best = -1;
+    for (int b = 0; b < PALETTE_BUCKETS; b++) {
+      if (pb->counts[b] > 0 && (best < 0 || pb->counts[b] > pb->counts[best])) {
+        best = b;
+      }
+    }
+    if (best < 0) {
+      break; // Fewer used buckets than palette entries
+    }
+    raw_palette[colors] = pb->representative[best];
+    pb->lut[best] = colors;
+    pb->counts[best] = 0; // Picked: mapped exactly
+  }
+
+  for (int b = 0; b < PALETTE_BUCKETS; b++) {
+    if (pb->counts[b] == 0) {
+      continue;
+    }
+    uint32_t best_distance = UINT32_MAX;
+    for (int i = 1; i < colors; i++) {
+      uint32_t d = color_distance(pb->representative[b], raw_palette[i]);
+      if (d < best_distance) {
+        best_distance = d;
+        pb->lut[b] = i;
+      }
+    }
+  }
+
+  palette[0] = 0;
+  for (int i = 1; i < 256; i++) {
+    palette[i] = swap_color_bytes(raw_palette[i]);
+  }
+}
+#endif
+
+/**
+ * @brief Loads an eye texture in the format selected by EYE_TEXTURE_INDEXED.
+ * RGB565 textures are read in one block. Indexed textures are read twice in
+ * strips of EYE_TEXTURE_CHUNK_ROWS rows (histogram, then mapping) and stored
+ * in row chunks, so no allocation is larger than a chunk.
+ * @param image_type The texture slot to fill.
+ * @param reader Callback that reads RGB565 rows from the asset.
+ * @param context Passed to the reader.
+ * @return true if the texture was loaded.
+ */
+bool load_eye_texture(EyeImageType image_type, TextureRowReader reader, void* context) {
+#if EYE_TEXTURE_INDEXED
+  const size_t chunk_pixels = (size_t)EYE_IMAGE_WIDTH * EYE_TEXTURE_CHUNK_ROWS;
+  PaletteBuilder* pb = (PaletteBuilder*)malloc(sizeof(PaletteBuilder));
+  uint16_t* rgb_rows = (uint16_t*)malloc(chunk_pixels * sizeof(uint16_t));
+  bool ok = pb && rgb_rows;
+  if (ok) {
+    memset(pb, 0, sizeof(PaletteBuilder));
+  }
+
+  // Pass 1: histogram of the opaque colors
+  for (int16_t row = 0; ok && row < EYE_IMAGE_HEIGHT; row += EYE_TEXTURE_CHUNK_ROWS) {
+    int16_t count = std::min<int16_t>(EYE_TEXTURE_CHUNK_ROWS, EYE_IMAGE_HEIGHT - row);
+    ok = reader(context, row, count, rgb_rows);
+    for (size_t i = 0; ok && i < (size_t)count * EYE_IMAGE_WIDTH; i++) {
+      uint16_t color = rgb_rows[i];
+      if (color == TRANSPARENT_COLOR_KEY) {
+        continue;
+      }
+      uint16_t bucket = palette_bucket(color);
+      if (pb->counts[bucket]++ == 0) {
+        pb->representative[bucket] = color;
+      }
+    }
+  }
+  if (ok) {
+    build_palette(pb, eye_texture.palettes[image_type]);
+  }
+
+  // Pass 2: map every pixel to its palette index, one row chunk at a time
+  for (int16_t row = 0; ok && row < EYE_IMAGE_HEIGHT; row += EYE_TEXTURE_CHUNK_ROWS) {
+    int16_t count = std::min<int16_t>(EYE_TEXTURE_CHUNK_ROWS, EYE_IMAGE_HEIGHT - row);
+    uint8_t* indices = (uint8_t*)alloc_texture_memory((size_t)count * EYE_IMAGE_WIDTH);
+    ok = indices && reader(context, row, count, rgb_rows);
+    for (size_t i = 0; ok && i < (size_t)count * EYE_IMAGE_WIDTH; i++) {
+      uint16_t color = rgb_rows[i];
+      indices[i] = (color == TRANSPARENT_COLOR_KEY) ? 0 : pb->lut[palette_bucket(color)];
+    }
+    for (int16_t r = 0; ok && r < count; r++) {
+      eye_texture.rows[image_type][row + r] = indices + r * EYE_IMAGE_WIDTH;
+    }
+    if (!ok) {
+      free(indices);
+    }
+  }
+
+  if (!ok) {
+    // Release the chunks already mapped; each chunk starts on a multiple of EYE_TEXTURE_CHUNK_ROWS
+    for (int16_t row = 0; row < EYE_IMAGE_HEIGHT; row += EYE_TEXTURE_CHUNK_ROWS) {
+      free(eye_texture.rows[image_type][row]);
+    }
+    memset(eye_texture.rows[image_type], 0, sizeof(eye_texture.rows[image_type]));
+  }
+  free(rgb_rows);
+  free(pb);
+  return ok;
+#else
+  size_t size = (size_t)EYE_IMAGE_WIDTH * EYE_IMAGE_HEIGHT * sizeof(uint16_t);
+  uint16_t* buffer = (uint16_t*)alloc_texture_memory(size);
+  if (!buffer) {
+    return false;
+  }
+  if (!reader(context, 0, EYE_IMAGE_HEIGHT, buffer)) {
+    free(buffer);
+    return false;
+  }
+  eye_texture.buffers[image_type] = buffer;
+  return true;
+#endif
+}
+
+// --- Core Drawing & Rendering ---
+
+/**
+ * @brief Draws the circular eye image with eyelid occlusion.
+ * This is the main rendering function for the eye itself, using multiple
+ * optimizations like pre-calculated scanlines and fixed-point math.
+ * @param x_pos The x-coordinate of the top-left of the image.
+ * @param y_pos The y-coordinate of the top-left of the image.
+ * @param eyelid_level The current level of the eyelid (0=open).
+ * @param image_type The type of eye image to draw (normal or bad).
+ */
+void draw_eye_image(int16_t x_pos, int16_t y_pos, uint8_t eyelid_level, EyeImageType image_type) {
+  // Boards short on memory may only hold the normal image.
+  if (!eye_texture_loaded(image_type)) {
+    image_type = EYE_IMAGE_NORMAL;
+  }
+  // If the image buffer has not been loaded, do nothing.
+  if (!eye_texture_loaded(image_type)) {
+    return;
+  }
+
+  const int16_t scaled_width = EYE_IMAGE_WIDTH;
+  const int16_t scaled_height = EYE_IMAGE_HEIGHT;
+
+  // Eyelid cutoff calculation
+  int16_t eyelid_y_cutoff = (eyelid_level / 128.0f) * (scaled_height / 2.0f);
+
+  // Only visit the image lines that fall in the current band
+  int16_t y_first = std::max<int16_t>(0, band_first_line - y_pos);
+  int16_t y_last = std::min<int16_t>(scaled_height, band_first_line + band_line_count - y_pos);
+
+  // --- Fixed-point integer optimization ---
+  uint32_t src_increment = 1 * 65536; // Scale factor is implicitly 1.0
+  uint32_t src_y_accum = y_first * src_increment;
+
+  for (int16_t y = y_first; y < y_last; y++) {
+    int16_t dest_y = y_pos + y;
+
+    // Skip lines that are off-screen or closed by the eyelid
+    if (dest_y < 0 || dest_y >= SCR_HT || y < eyelid_y_cutoff || y >= (scaled_height - eyelid_y_cutoff)) {
+      src_y_accum += src_increment;
+      continue;
+    }
+
+    // --- Using pre-calculated scanlines ---
+    int16_t x_start_visible = circular_scanlines[dest_y].x_start;
+    int16_t x_end_visible = circular_scanlines[dest_y].x_end;
+
+    // If the line is not visible, skip to the next one
+    if (x_start_visible == -1) {
+        src_y_accum += src_increment;
+        continue;
+    }
+
+    // Determine the actual drawing range, taking the image position into account
+    int16_t x_start_draw = std::max(x_start_visible, (int16_t)x_pos);
+    int16_t x_end_draw = std::min(x_end_visible, (int16_t)(x_pos + scaled_width));
+
+    int16_t src_y = src_y_accum >> 16;
+    uint16_t* framebuffer_line = get_framebuffer_line(dest_y);
+    
+    // Initialize the X accumulator for the first visible coordinate
+    uint32_t src_x_accum = (x_start_draw - x_pos) * src_increment;
+
+#if EYE_TEXTURE_INDEXED
+    const uint8_t* source_line = eye_texture.rows[image_type][src_y]; // Calculate source line address once
+    const uint16_t* palette = eye_texture.palettes[image_type];       // Already byte-swapped
+
+    for (int16_t dest_x = x_start_draw; dest_x < x_end_draw; dest_x++) {
+        uint8_t index = source_line[src_x_accum >> 16];
+        if (index != 0) { // Index 0 is the transparent color key
+            framebuffer_line[dest_x] = palette[index];
+        }
+        src_x_accum += src_increment; // Increment for the next pixel
+    }
+#else
+    uint16_t* source_line = &eye_texture.buffers[image_type][src_y * EYE_IMAGE_WIDTH]; // Calculate source line address once
+
+    // Do not draw parts of the eye closed by the eyelid
+    for (int16_t dest_x = x_start_draw; dest_x < x_end_draw; dest_x++) {
+        int16_t src_x = src_x_accum >> 16;
+
+        uint16_t source_color = source_line[src_x]; // Read from the pre-calculated line
+        if (source_color == TRANSPARENT_COLOR_KEY) {
+            // Do nothing (the color key is transparent)
+        } else { // For all other colors
+            // Inline the drawPixel logic for performance
+            framebuffer_line[dest_x] = swap_color_bytes(source_color);
+        }
+        src_x_accum += src_increment; // Increment for the next pixel
+    }
+#endif
+    src_y_accum += src_increment;
+  }
+}
+
+/**
+ * @brief Converts a normalized target coordinate to the integer pixel offset of the eye.
+ * @param target_x The horizontal target, from -1.0 (left) to 1.0 (right).
+ * @param target_y The vertical target, from -1.0 (up) to 1.0 (down).
+ * @param x_offset Receives the horizontal offset from the resting position.
+ * @param y_offset Receives the vertical offset from the resting position.
+ */
+void get_eye_offset(float target_x, float target_y, int16_t* x_offset, int16_t* y_offset) {
+    *x_offset = target_x * MAX_2D_OFFSET_PIXELS;
+    *y_offset = target_y * MAX_2D_OFFSET_PIXELS;
+}
+
+/**
+ * @brief Draws the eye centered and looking at a normalized target coordinate.
+ * This function simplifies the main loop logic by handling all position
+ * calculations internally.
+ * @param target_x The horizontal target, from -1.0 (left) to 1.0 (right).
+ * @param target_y The vertical target, from -1.0 (up) to 1.0 (down).
+ * @param eyelid_level The current level of the eyelid (0=open).
+ * @param image_type The type of eye image to draw (normal or bad).
+ */
+void draw_eye_at_target(float target_x, float target_y, uint8_t eyelid_level, EyeImageType image_type) {
+    // Calculate the final pixel offset based on the normalized target coordinates
+    int16_t x_offset, y_offset;
+    get_eye_offset(target_x, target_y, &x_offset, &y_offset);
+    draw_eye_image(RESTING_2D_OFFSET_PIXELS + x_offset, RESTING_2D_OFFSET_PIXELS + y_offset, eyelid_level, image_type);
+}
+
+/**
+ * @brief Draws a simple crosshair at a given center point.
+ * @param center_x The x-coordinate of the crosshair center.
+ * @param center_y The y-coordinate of the crosshair center.
+ * @param size The size of the crosshair arms.
+ * @param color The 16-bit color of the crosshair.
+ */
+void draw_crosshair(int16_t center_x, int16_t center_y, int16_t size, uint16_t color) {
+    uint16_t swapped_color = swap_color_bytes(color);
+
+    // Horizontal line
+    uint16_t* center_line = get_framebuffer_line(center_y);
+    for (int16_t x = center_x - size; x <= center_x + size; ++x) {
+        if (x >= 0 && x < SCR_WD && center_line) {
+            center_line[x] = swapped_color;
+        }
+    }
+
+    // Vertical line
+    for (int16_t y = center_y - size; y <= center_y + size; ++y) {
+        uint16_t* line = get_framebuffer_line(y);
+        if (line && center_x >= 0 && center_x < SCR_WD) {
+            line[center_x] = swapped_color;
+        }
+    }
+}
@@ -0,0 +1,245 @@
+/**
+ * @file frame_cache.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Implementation of the memoized eye frame cache.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "frame_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#define FRAME_CACHE_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+#define FRAME_CACHE_PRINTF printf
+#endif
+
+#if FRAME_CACHE_ENABLED
+
+static const size_t FRAME_BYTES = SCR_WD * SCR_HT * sizeof(uint16_t);
+static const int MAX_CACHED_FRAMES = 64;
+
+struct CachedFrame {
+    uint64_t key;
+    uint32_t last_used;    // Value of use_clock at the last hit or insertion
+    bool valid;
+    uint16_t* pixels;
+};
+
+// --- Module-Private State ---
+static CachedFrame entries[MAX_CACHED_FRAMES];
+static int entry_count = 0;
+static uint32_t use_clock = 0;
+static FrameCacheStats stats = {};
+static unsigned long last_report_ms = 0;
+
+// Key of the previous frame drawn on each screen. A pose is only stored once it is
+// drawn twice in a row, so a moving eye does not pay the copy into the cache on
+// every frame for poses it will not come back to.
+static uint64_t last_key[NUM_SCREEN];
+static bool last_key_valid[NUM_SCREEN];
+
+static uint32_t now_us() {
+#if defined(ARDUINO)
+    return micros();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+static uint64_t pack_key(const FrameKey& key) {
+    return (uint64_t)(uint16_t)key.x_offset | ((uint64_t)(uint16_t)key.y_offset << 16) |
+           ((uint64_t)key.image_type << 32) | ((uint64_t)key.eyelid_level << 40) | ((uint64_t)key.overlay << 48);
+}
+
+static int active_screen() {
+    for (int i = 0; i < NUM_SCREEN; i++) {
+        if (framebuffers[i] == get_active_framebuffer()) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the entry holding a key and marks it as most recently used.
+ * @return The entry, or nullptr on a miss.
+ */
+static CachedFrame* lookup(uint64_t key) {
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].valid && entries[i].key == key) {
+            entries[i].last_used = ++use_clock;
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Copies the active framebuffer into a free or least recently used entry.
+ */
+static void store(uint64_t key) {
+    CachedFrame* victim = &entries[0];
+    for (int i = 0; i < entry_count; i++) {
+        if (!entries[i].valid) {
+            victim = &entries[i];
+            break;
+        }
+        if (entries[i].last_used < victim->last_used) {
+            victim = &entries[i];
+        }
+    }
+    if (victim->valid) {
+        stats.evictions++;
+    }
+
+    uint32_t start = now_us();
+    memcpy(victim->pixels, get_active_framebuffer(), FRAME_BYTES);
+    stats.store_us += now_us() - start;
+
+    victim->key = key;
+    victim->valid = true;
+    victim->last_used = ++use_clock;
+    stats.insertions++;
+}
+
+/**
+ * @brief Allocates the cached frames in PSRAM (heap on the host).
+ */
+void init_frame_cache() {
+    int budget_frames = FRAME_CACHE_BUDGET_BYTES / FRAME_BYTES;
+    if (budget_frames > MAX_CACHED_FRAMES) {
+        budget_frames = MAX_CACHED_FRAMES;
+    }
+    for (entry_count = 0; entry_count < budget_frames; entry_count++) {
+#if defined(ARDUINO)
+        uint16_t* pixels = (uint16_t*)ps_malloc(FRAME_BYTES);
+#else
+        uint16_t* pixels = (uint16_t*)malloc(FRAME_BYTES);
+#endif
+        if (!pixels) {
+            break;
+        }
+        entries[entry_count] = CachedFrame{0, 0, false, pixels};
+    }
+
+    // With fewer entries than screens, a frame being presented could be evicted by the next screen
+    if (entry_count < NUM_SCREEN) {
+        for (int i = 0; i < entry_count; i++) {
+            free(entries[i].pixels);
+        }
+        entry_count = 0;
+    }
+    stats.frames = entry_count;
+    FRAME_CACHE_PRINTF("Frame cache: %d frames (%u KB)%s.\n", entry_count, (unsigned)(entry_count * FRAME_BYTES / 1024),
+                       entry_count == 0 ? ", not enough memory, disabled" : "");
+}
+
+const uint16_t* draw_eye_at_target_cached(float target_x, float target_y, uint8_t eyelid_level,
+                                          EyeImageType image_type, uint16_t background, bool needs_framebuffer) {
+    if (!eye_texture_loaded(image_type)) {
+        image_type = EYE_IMAGE_NORMAL; // Same fallback as draw_eye_image(), so both share frames
+    }
+    FrameKey frame_key;
+    get_eye_offset(target_x, target_y, &frame_key.x_offset, &frame_key.y_offset);
+    frame_key.image_type = image_type;
+    frame_key.eyelid_level = eyelid_level;
+    frame_key.overlay = FRAME_OVERLAY_NONE;
+    uint64_t key = pack_key(frame_key);
+
+    int screen = active_screen();
+    bool repeated = last_key_valid[screen] && last_key[screen] == key;
+    last_key[screen] = key;
+    last_key_valid[screen] = true;
+
+    CachedFrame* entry = lookup(key);
+    if (entry) {
+        stats.hits++;
+        if (!needs_framebuffer) {
+            stats.direct_hits++;
+            return entry->pixels;
+        }
+        uint32_t start = now_us();
+        memcpy(get_active_framebuffer(), entry->pixels, FRAME_BYTES);
+        stats.hit_us += now_us() - start;
+        return get_active_framebuffer();
+    }
+
+    stats.misses++;
+    uint32_t start = now_us();
+    clear_buffer(background);
+    draw_eye_at_target(target_x, target_y, eyelid_level, image_type);
+    stats.render_us += now_us() - start;
+
+    if (repeated && entry_count > 0) {
+        store(key);
+    }
+    return get_active_framebuffer();
+}
+
+FrameCacheStats get_frame_cache_stats() {
+    return stats;
+}
+
+/**
+ * @brief Prints the hit rate and the rendering time saved, then starts a new interval.
+ * The time saved counts each hit as one average miss render, minus the time spent
+ * on copies in and out of the cache.
+ */
+void log_frame_cache_stats_if_due() {
+#if defined(ARDUINO)
+    unsigned long now = millis();
+#else
+    unsigned long now = now_us() / 1000;
+#endif
+    if (now - last_report_ms < FRAME_CACHE_REPORT_INTERVAL_MS) {
+        return;
+    }
+    last_report_ms = now;
+
+    uint32_t lookups = stats.hits + stats.misses;
+    if (lookups > 0) {
+        float avg_render_us = stats.misses > 0 ? (float)stats.render_us / stats.misses : 0.0f;
+        float saved_ms = (stats.hits * avg_render_us - stats.hit_us - stats.store_us) / 1000.0f;
+        FRAME_CACHE_PRINTF("Frame cache: hit rate %.1f%% (%u hits, %u direct, %u misses), %u stored, %u evicted, "
+                           "render %.0f us, hit copy %.0f us, saved %.0f ms\n",
+                           100.0f * stats.hits / lookups, stats.hits, stats.direct_hits, stats.misses,
+                           stats.insertions, stats.evictions, avg_render_us,
+                           stats.hits > stats.direct_hits ? (float)stats.hit_us / (stats.hits - stats.direct_hits) : 0.0f,
+                           saved_ms);
+    }
+
+    uint32_t frames = stats.frames;
+    stats = FrameCacheStats{};
+    stats.frames = frames;
+}
+
+#else // FRAME_CACHE_ENABLED
+
+void init_frame_cache() {}
+
+const uint16_t* draw_eye_at_target_cached(float target_x, float target_y, uint8_t eyelid_level,
+                                          EyeImageType image_type, uint16_t background, bool needs_framebuffer) {
+    clear_buffer(background);
+    draw_eye_at_target(target_x, target_y, eyelid_level, image_type);
+    return get_active_framebuffer();
+}
+
+FrameCacheStats get_frame_cache_stats() {
+    return FrameCacheStats{};
+}
+
+void log_frame_cache_stats_if_due() {}
+
+#endif // FRAME_CACHE_ENABLED
@@ -15,6 +15,10 @@
 #include "drawing_tools.h"
 #include "eye_logic.h"
 #include "tof_sensor.h"
+#include "event_log.h"
+#include "perf_counters.h"
+#include "frame_cache.h"
+#include "reflex.h"
 #include "LittleFS.h"
 
 // --- FPS Counter Variables ---
@@ -22,6 +26,57 @@ static unsigned long last_fps_time = 0;
 static int frame_count = 0;
 static float current_fps = 0.0f;
 
+// --- Event Log Variables ---
+static unsigned long last_fps_report_time = 0;
+static long fps_report_frame_count = 0;
+static bool was_target_valid = false;
+static unsigned long target_acquired_time = 0;
+
+
+// --- Rendering ---
+
+/**
+ * @brief Draws one screen (the current render band of it) into its framebuffer.
+ * @param i The screen index (EYE_LEFT or EYE_RIGHT).
+ * @param target The ToF target used for this frame.
+ * @return The frame to present: the framebuffer, or a cached frame when the
+ *         eye was already rendered at this pose and nothing is drawn over it.
+ */
+static const uint16_t* render_eye_screen(int i, const TofTarget& target) {
+  // Only the framebuffer: chip selects are driven by push_lines() under the display lock
+  set_active_framebuffer(i);
+
+  // Get the final calculated position and image type for the current eye
+  EyePosition pos = get_eye_position(i);
+  EyeImageType image_type = get_current_eye_image_type(target);
+
+  // Overlays are drawn on top of the eye, so this screen needs the eye in its framebuffer
+  bool has_overlay = USE_TOF_SENSOR && SHOW_TOF_DEBUG_GRID && i == EYE_RIGHT;
+
+  // Draw the eye at its final calculated position, or reuse an identical frame
+  const uint16_t* frame = draw_eye_at_target_cached(pos.x, pos.y, 0, image_type, TFT_BLACK, has_overlay); // 0 = eyelid open
+
+  // Optional: Draw the ToF debug grid on one of the screens
+  #if USE_TOF_SENSOR && SHOW_TOF_DEBUG_GRID
+    if (has_overlay) { // Draw only on the right eye screen
+      const int16_t grid_size = 80;
+      const int16_t grid_pos = (SCR_WD - grid_size) / 2;
+      // Get raw sensor data for display
+      const VL53L5CX_ResultsData* tof_data = get_tof_measurement_data();
+      // Use the same 'target' that was used for the eye movement
+     draw_tof_debug_grid(grid_pos, grid_pos, grid_size, tof_data, target.min_dist_pixel_x, target.min_dist_pixel_y);
+
+      // --- Draw FPS Counter ---
+      char fps_str[10];
+      dtostrf(current_fps, 4, 1, fps_str); // Format float to string (width 4, 1 decimal)
+      char display_str[15];
+      sprintf(display_str, "FPS: %s", fps_str);
+      drawString_fb(display_str, 5, 5, TFT_WHITE);
+    }
+  #endif
+  return frame;
+}
+
 
 // --- Debugging ---
 
@@ -38,8 +93,22 @@ void setup() {
     while (1) { delay(100); }
   }
 
+  // Start the session event log now that the filesystem is available
+  #if USE_EVENT_LOG
+    #if EVENT_LOG_BENCHMARK
+      benchmark_event_log_write();
+    #endif
+    init_event_log();
+    log_event(EVENT_BOOT, 0, ESP.getFreeHeap());
+  #endif
+
   sleep(1);
 
+  // The display lock is used by every push, so it must exist before the first one
+  #if REFLEX_ENABLED
+    init_reflex();
+  #endif
+
   // Initialize displays and load graphical assets
   init_tft();
 
@@ -59,6 +128,14 @@ void setup() {
     #endif
   #endif
 
+  #if FRAME_CACHE_ENABLED
+    init_frame_cache();
+  #endif
+
+  #if PERF_COUNTER_PROFILING
+    init_perf_counters();
+  #endif
+
   Serial.println("Initialization complete. Starting main loop.");
 }
 
@@ -66,8 +143,17 @@ void setup() {
  * @brief Main application loop.
  */
 void loop() {
+  #if REFLEX_ENABLED
+    // The eyelids are closed by the reflex: sleep until it is over, and leave
+    // the hold out of the FPS figures since no frame is drawn during it
+    unsigned long held_ms = reflex_wait_hold();
+    last_fps_time += held_ms;
+    last_fps_report_time += held_ms;
+  #endif
+
   // --- FPS Calculation ---
   frame_count++;
+  fps_report_frame_count++;
   unsigned long current_millis = millis();
   if (current_millis - last_fps_time >= 1000) {
     // Calculate FPS over the last second
@@ -75,9 +161,32 @@ void loop() {
     last_fps_time = current_millis;
     frame_count = 0;
     Serial.printf("FPS: %.1f\n", current_fps); // Print FPS to serial log
+
+    #if USE_EVENT_LOG
+      if (current_fps < EVENT_LOG_FPS_DIP_THRESHOLD) {
+        log_event(EVENT_FPS_DIP, current_fps * 10, EVENT_LOG_FPS_DIP_THRESHOLD * 10);
+      }
+    #endif
   }
 
+  #if USE_EVENT_LOG
+    // Record the average FPS over a longer interval to keep the log compact
+    if (current_millis - last_fps_report_time >= EVENT_LOG_FPS_REPORT_INTERVAL_MS) {
+      float average_fps = fps_report_frame_count / ((current_millis - last_fps_report_time) / 1000.0f);
+      log_event(EVENT_FPS_REPORT, average_fps * 10, fps_report_frame_count);
+      log_event_log_stats();
+      last_fps_report_time = current_millis;
+      fps_report_frame_count = 0;
+    }
+
+    // Send 'L' over the Serial monitor to dump the log for decode_event_log.py
+    if (Serial.available() && Serial.read() == 'L') {
+      dump_event_log();
+    }
+  #endif
+
   // --- 1. Sensor Update ---
+  PERF_STAGE_BEGIN(PERF_STAGE_SENSOR);
   #if USE_TOF_SENSOR
     #if TOF_CALIBRATION_MODE
       // In calibration mode, force an update on every frame
@@ -87,44 +196,68 @@ void loop() {
     #endif
   #endif
   TofTarget target = get_tof_target();
+  PERF_STAGE_END(PERF_STAGE_SENSOR);
+
+  #if USE_EVENT_LOG
+    // Record tracking sessions: one acquired/lost pair per tracked visitor
+    if (target.is_valid && !was_target_valid) {
+      target_acquired_time = current_millis;
+      log_event(EVENT_TARGET_ACQUIRED, target.distance_mm, target.min_dist_pixel_y * 8 + target.min_dist_pixel_x);
+    } else if (!target.is_valid && was_target_valid) {
+      log_event(EVENT_TARGET_LOST, 0, current_millis - target_acquired_time);
+    }
+    was_target_valid = target.is_valid;
+  #endif
+
+  #if REFLEX_ENABLED
+    // A reflex raised since the top of the loop: leave this frame, the next one waits
+    if (reflex_active()) {
+      PERF_FRAME_END();
+      return;
+    }
+  #endif
 
   // --- 2. Eye Position Logic ---
   // Update the logical positions of the eyes based on the target
+  PERF_STAGE_BEGIN(PERF_STAGE_LOGIC);
   update_eye_positions(target);
+  PERF_STAGE_END(PERF_STAGE_LOGIC);
 
-  // --- 3. Drawing ---
-  for (int i = 0; i < NUM_SCREEN; i++) {
-    select_screen(i);
-    clear_buffer(TFT_BLACK);
-
-    // Get the final calculated position and image type for the current eye
-    EyePosition pos = get_eye_position(i);
-    EyeImageType image_type = get_current_eye_image_type(target);
-
-    // Draw the eye at its final calculated position
-    draw_eye_at_target(pos.x, pos.y, 0, image_type); // 0 = eyelid open
-
-    // Optional: Draw the ToF debug grid on one of the screens
-    #if USE_TOF_SENSOR && SHOW_TOF_DEBUG_GRID
-      if (i == EYE_RIGHT) { // Draw only on the right eye screen
-        const int16_t grid_size = 80;
-        const int16_t grid_pos = (SCR_WD - grid_size) / 2;
-        // Get raw sensor data for display
-        const VL53L5CX_ResultsData* tof_data = get_tof_measurement_data();
-        // Use the same 'target' that was used for the eye movement
-       draw_tof_debug_grid(grid_pos, grid_pos, grid_size, tof_data, target.min_dist_pixel_x, target.min_dist_pixel_y);
-
-        // --- Draw FPS Counter ---
-        char fps_str[10];
-        dtostrf(current_fps, 4, 1, fps_str); // Format float to string (width 4, 1 decimal)
-        char display_str[15];
-        sprintf(display_str, "FPS: %s", fps_str);
-        drawString_fb(display_str, 5, 5, TFT_WHITE);
-      }
-    #endif
+  // --- 3. Drawing & 4. Display Update ---
+  // The screen is rendered band by band: a single band covering the whole screen
+  // with full framebuffers, or EYE_STRIP_LINES lines at a time in strip mode.
+  const uint16_t* frames[NUM_SCREEN] = {framebuffers[EYE_LEFT], framebuffers[EYE_RIGHT]};
+  for (int16_t band_y = 0; band_y < SCR_HT; band_y += EYE_RENDER_BAND_LINES) {
+    set_render_band(band_y, min(EYE_RENDER_BAND_LINES, SCR_HT - band_y));
+    for (int i = 0; i < NUM_SCREEN; i++) {
+      #if REFLEX_ENABLED
+        if (reflex_active()) break; // Preempted: the pushes below give up as well
+      #endif
+      PERF_STAGE_BEGIN(PERF_STAGE_RENDER);
+      frames[i] = render_eye_screen(i, target);
+      PERF_STAGE_END(PERF_STAGE_RENDER);
+
+      #if EYE_RENDER_STRIP
+        // The strip is shared by both screens: push it before drawing the next one
+        PERF_STAGE_BEGIN(PERF_STAGE_PUSH);
+        display_band(i);
+        PERF_STAGE_END(PERF_STAGE_PUSH);
+      #endif
+    }
   }
 
-  // --- 4. Display Update ---
-  // Push the completed framebuffers to the physical screens
-  display_all_buffers();
+  #if !EYE_RENDER_STRIP
+    // Push the completed frames to the physical screens
+    PERF_STAGE_BEGIN(PERF_STAGE_PUSH);
+    for (int i = 0; i < NUM_SCREEN; i++) {
+      display_frame(i, frames[i]);
+    }
+    PERF_STAGE_END(PERF_STAGE_PUSH);
+  #endif
+
+  #if FRAME_CACHE_ENABLED
+    log_frame_cache_stats_if_due();
+  #endif
+
+  PERF_FRAME_END();
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+/**
+ * @file perf_counters.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Implementation of per-stage hardware performance-counter sampling.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "perf_counters.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#define PERF_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#include <time.h>
+#define PERF_PRINTF printf
+#endif
+
+#if defined(ARDUINO) && defined(__XTENSA__) && __has_include(<xtensa_perfmon_access.h>)
+#include <xtensa_perfmon_access.h>
+#include <xtensa_perfmon_masks.h>
+#define PERF_USE_XTENSA_PERFMON 1
+#elif !defined(ARDUINO) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#define PERF_USE_LINUX_PERF_EVENT 1
+#endif
+
+// Raw counter indices, in the order of the PerfCounters fields.
+enum RawCounter {
+    RAW_CYCLES = 0,
+    RAW_INSTRUCTIONS,
+    RAW_DCACHE,
+    RAW_ICACHE,
+    NUM_RAW_COUNTERS
+};
+
+// --- Module-Private State ---
+static PerfCounters current_frame[NUM_PERF_STAGES];  // Being accumulated
+static PerfCounters last_frame[NUM_PERF_STAGES];     // Last completed frame
+static uint32_t stage_start_raw[NUM_PERF_STAGES][NUM_RAW_COUNTERS];
+static uint32_t stage_start_us[NUM_PERF_STAGES];
+static uint32_t frame_index = 0;
+
+static const char* STAGE_NAMES[NUM_PERF_STAGES] = {"sensor", "logic", "render", "push"};
+
+#if PERF_USE_XTENSA_PERFMON
+// The ESP32-S3 core has two performance counters. Counter 0 always counts
+// instructions; counter 1 alternates between D-cache and I-cache miss stalls
+// on every frame, so each stall figure is refreshed every other frame.
+static bool stall_counter_is_dcache = true;
+
+static void program_stall_counter() {
+    if (stall_counter_is_dcache) {
+        xtensa_perfmon_init(1, XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_CACHE_MISS, 0, -1);
+    } else {
+        xtensa_perfmon_init(1, XTPERF_CNT_I_STALL, XTPERF_MASK_I_STALL_CACHE_MISS, 0, -1);
+    }
+    xtensa_perfmon_reset(1);
+}
+#endif
+
+#if PERF_USE_LINUX_PERF_EVENT
+static int perf_fds[NUM_RAW_COUNTERS] = {-1, -1, -1, -1};
+
+/**
+ * @brief Opens one user-space counter for the calling thread.
+ * @return The file descriptor, or -1 if the event is not available.
+ */
+static int open_perf_event(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t l1_read_miss_config(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+/**
+ * @brief Reads the free-running counters. Values wrap at 32 bits; only
+ * differences are meaningful.
+ */
+static void read_raw_counters(uint32_t raw[NUM_RAW_COUNTERS]) {
+#if PERF_USE_XTENSA_PERFMON
+    raw[RAW_CYCLES] = ESP.getCycleCount();
+    raw[RAW_INSTRUCTIONS] = xtensa_perfmon_value(0);
+    raw[RAW_DCACHE] = stall_counter_is_dcache ? xtensa_perfmon_value(1) : 0;
+    raw[RAW_ICACHE] = stall_counter_is_dcache ? 0 : xtensa_perfmon_value(1);
+#elif defined(ARDUINO)
+    raw[RAW_CYCLES] = ESP.getCycleCount();
+    raw[RAW_INSTRUCTIONS] = 0;
+    raw[RAW_DCACHE] = 0;
+    raw[RAW_ICACHE] = 0;
+#elif PERF_USE_LINUX_PERF_EVENT
+    for (int i = 0; i < NUM_RAW_COUNTERS; i++) {
+        uint64_t value = 0;
+        if (perf_fds[i] < 0 || read(perf_fds[i], &value, sizeof(value)) != sizeof(value)) {
+            value = 0;
+        }
+        raw[i] = (uint32_t)value;
+    }
+#else
+    for (int i = 0; i < NUM_RAW_COUNTERS; i++) {
+        raw[i] = 0;
+    }
+#endif
+}
+
+static uint32_t now_us() {
+#if defined(ARDUINO)
+    return micros();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+/**
+ * @brief Programs and starts the counters.
+ */
+void init_perf_counters() {
+#if PERF_USE_XTENSA_PERFMON
+    xtensa_perfmon_stop();
+    xtensa_perfmon_init(0, XTPERF_CNT_INSN, XTPERF_MASK_INSN_ALL, 0, -1);
+    xtensa_perfmon_reset(0);
+    program_stall_counter();
+    xtensa_perfmon_start();
+    PERF_PRINTF("Perf counters: Xtensa perfmon (instructions, cache-miss stalls) + CCOUNT.\n");
+#elif defined(ARDUINO)
+    PERF_PRINTF("Perf counters: perfmon not available on this target, cycles only.\n");
+#elif PERF_USE_LINUX_PERF_EVENT
+    perf_fds[RAW_CYCLES] = open_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    perf_fds[RAW_INSTRUCTIONS] = open_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf_fds[RAW_DCACHE] = open_perf_event(PERF_TYPE_HW_CACHE, l1_read_miss_config(PERF_COUNT_HW_CACHE_L1D));
+    perf_fds[RAW_ICACHE] = open_perf_event(PERF_TYPE_HW_CACHE, l1_read_miss_config(PERF_COUNT_HW_CACHE_L1I));
+    int opened = 0;
+    for (int i = 0; i < NUM_RAW_COUNTERS; i++) {
+        opened += perf_fds[i] >= 0;
+    }
+    PERF_PRINTF("Perf counters: perf_event, %d of %d counters available%s.\n", opened, NUM_RAW_COUNTERS,
+                opened < NUM_RAW_COUNTERS ? " (check /proc/sys/kernel/perf_event_paranoid)" : "");
+#else
+    PERF_PRINTF("Perf counters: no counter backend on this platform, time only.\n");
+#endif
+}
+
+void perf_stage_begin(PerfStage stage) {
+    stage_start_us[stage] = now_us();
+    read_raw_counters(stage_start_raw[stage]);
+}
+
+void perf_stage_end(PerfStage stage) {
+    uint32_t raw[NUM_RAW_COUNTERS];
+    read_raw_counters(raw);
+    uint32_t end_us = now_us();
+
+    PerfCounters& counters = current_frame[stage];
+    counters.time_us += end_us - stage_start_us[stage];
+    counters.cycles += raw[RAW_CYCLES] - stage_start_raw[stage][RAW_CYCLES];
+    counters.instructions += raw[RAW_INSTRUCTIONS] - stage_start_raw[stage][RAW_INSTRUCTIONS];
+    counters.dcache_stalls += raw[RAW_DCACHE] - stage_start_raw[stage][RAW_DCACHE];
+    counters.icache_stalls += raw[RAW_ICACHE] - stage_start_raw[stage][RAW_ICACHE];
+}
+
+/**
+ * @brief Publishes the counters of the frame and prints them periodically.
+ */
+void perf_frame_end(bool report) {
+    for (int i = 0; i < NUM_PERF_STAGES; i++) {
+#if PERF_USE_XTENSA_PERFMON
+        // Keep the stall figure that was not measured this frame from the previous one.
+        if (stall_counter_is_dcache) {
+            current_frame[i].icache_stalls = last_frame[i].icache_stalls;
+        } else {
+            current_frame[i].dcache_stalls = last_frame[i].dcache_stalls;
+        }
+#endif
+        last_frame[i] = current_frame[i];
+        current_frame[i] = PerfCounters{};
+    }
+
+#if PERF_USE_XTENSA_PERFMON
+    xtensa_perfmon_stop();
+    stall_counter_is_dcache = !stall_counter_is_dcache;
+    program_stall_counter();
+    xtensa_perfmon_start();
+#endif
+
+    if (frame_index++ % PERF_COUNTER_REPORT_INTERVAL_FRAMES != 0 || !report) {
+        return;
+    }
+    PERF_PRINTF("PERF frame %u:\n", frame_index - 1);
+    for (int i = 0; i < NUM_PERF_STAGES; i++) {
+        const PerfCounters& c = last_frame[i];
+        float ipc = c.cycles > 0 ? (float)c.instructions / c.cycles : 0.0f;
+        PERF_PRINTF("  %-6s %7u us %10u cyc %10u ins (IPC %.2f) %9u dstall %9u istall\n",
+                    STAGE_NAMES[i], c.time_us, c.cycles, c.instructions, ipc, c.dcache_stalls, c.icache_stalls);
+    }
+}
+
+PerfCounters get_perf_stage_counters(PerfStage stage) {
+    return last_frame[stage];
+}
+
+const char* get_perf_stage_name(PerfStage stage) {
+    return STAGE_NAMES[stage];
+}
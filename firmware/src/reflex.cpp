@@ -0,0 +1,188 @@
+/**
+ * @file reflex.cpp
+ * @author Intellar (https://github.com/intellar)
+ * @brief Implementation of the blink reflex.
+ * @version 1.0
+ *
+ * @copyright Copyright (c) 2025
+ *
+ * @license See LICENSE.md for details.
+ *
+ */
+#include "reflex.h"
+#include "drawing_tools.h"
+#include "event_log.h"
+
+#if REFLEX_ENABLED
+
+// --- Module-Private State ---
+static SemaphoreHandle_t display_mutex = nullptr; // A mutex, so loop() inherits the sensor task priority while it holds it
+static volatile bool reflex_pending = false;      // Raised on detection, cleared once the eyelids are closed
+// Hold and arming windows are a flag plus a start time compared with unsigned
+// math, which stays correct across the 49.7-day millis() wrap. Only the sensor
+// task writes them; the flags are set after their timestamps.
+static volatile bool holding = false;             // Eyelids held closed for REFLEX_HOLD_MS from hold_start_ms
+static volatile unsigned long hold_start_ms = 0;
+static volatile bool armed = false;               // A zone was within REFLEX_ARM_DIST_MM at armed_since_ms
+static volatile unsigned long armed_since_ms = 0; // Last frame with a zone that close: flash writes wait REFLEX_ARM_HOLD_MS after it
+
+// Closest zone of the previous frame, to estimate the approach speed
+static int previous_closest_mm = -1;
+static uint32_t previous_frame_us = 0;
+
+// --- Latency Statistics ---
+static uint32_t reflex_count = 0;
+static uint32_t measured_count = 0;                      // Reflexes on a frame announced by the interrupt
+static uint32_t detect_us_max = 0, detect_us_sum = 0;   // Sensor interrupt -> approach detected
+static uint32_t present_us_max = 0, present_us_sum = 0; // Sensor interrupt -> eyelids closed on both screens
+
+void init_reflex() {
+    display_mutex = xSemaphoreCreateMutex();
+    Serial.printf("Blink reflex enabled: closer than %d mm at more than %d mm/s, latency budget %u us.\n",
+                  REFLEX_DIST_MM, REFLEX_MIN_SPEED_MM_S, REFLEX_LATENCY_BUDGET_US);
+}
+
+static bool hold_in_progress() {
+    return holding && millis() - hold_start_ms < REFLEX_HOLD_MS;
+}
+
+static bool armed_in_progress() {
+    return armed && millis() - armed_since_ms < REFLEX_ARM_HOLD_MS;
+}
+
+bool reflex_active() {
+    return reflex_pending || hold_in_progress();
+}
+
+/**
+ * @brief Sleeps until the reflex is over, instead of spinning on reflex_active().
+ * @return The time spent waiting in ms, 0 if no reflex was active.
+ */
+unsigned long reflex_wait_hold() {
+    unsigned long start = millis();
+    while (reflex_active()) {
+        // While the reflex is pending the hold is not started yet: wait one tick and check again
+        unsigned long elapsed_ms = millis() - hold_start_ms;
+        unsigned long remaining_ms = hold_in_progress() && elapsed_ms < REFLEX_HOLD_MS ? REFLEX_HOLD_MS - elapsed_ms : 0;
+        vTaskDelay(max((TickType_t)1, (TickType_t)pdMS_TO_TICKS(remaining_ms)));
+    }
+    return millis() - start;
+}
+
+/**
+ * @brief Waits until no zone has been within REFLEX_ARM_DIST_MM for REFLEX_ARM_HOLD_MS,
+ * or REFLEX_FLASH_MAX_DEFER_MS, so a flash write does not stall the sensor task
+ * while an approach may be about to trigger the reflex.
+ */
+void reflex_wait_flash_window() {
+    unsigned long start = millis();
+    while (armed_in_progress() && millis() - start < REFLEX_FLASH_MAX_DEFER_MS) {
+        vTaskDelay(pdMS_TO_TICKS(REFLEX_TASK_POLL_MS));
+    }
+}
+
+void reflex_display_lock() {
+    xSemaphoreTake(display_mutex, portMAX_DELAY);
+}
+
+void reflex_display_unlock() {
+    xSemaphoreGive(display_mutex);
+}
+
+/**
+ * @brief Returns the distance of the closest valid zone, or -1 if there is none.
+ */
+static int closest_zone_mm(const VL53L5CX_ResultsData* data) {
+    int closest = -1;
+    for (int zone = 0; zone < 64; zone++) {
+        if (data->target_status[zone] == 5 && (closest < 0 || data->distance_mm[zone] < closest)) {
+            closest = data->distance_mm[zone];
+        }
+    }
+    return closest;
+}
+
+/**
+ * @brief Detects a fast approach in the newest frame and closes the eyelids.
+ * Runs in the sensor task, which has the highest application priority.
+ * @param data The frame just read from the sensor.
+ * @param frame_time_us micros() at the sensor interrupt that announced the frame,
+ *        or at the read for a polled frame.
+ * @param from_interrupt False for a frame read on the poll timeout: its latency is not measured.
+ */
+void reflex_on_sensor_frame(const VL53L5CX_ResultsData* data, uint32_t frame_time_us, bool from_interrupt) {
+    int closest = closest_zone_mm(data);
+    int32_t elapsed_us = frame_time_us - previous_frame_us;
+    float speed_mm_s = 0.0f;
+    if (closest >= 0 && previous_closest_mm >= 0 && elapsed_us > 0) {
+        speed_mm_s = (previous_closest_mm - closest) * 1000000.0f / elapsed_us;
+    }
+    previous_closest_mm = closest;
+    previous_frame_us = frame_time_us;
+    if (closest >= 0 && closest < REFLEX_ARM_DIST_MM) {
+        armed_since_ms = millis();
+        armed = true;
+    } else if (!armed_in_progress()) {
+        armed = false;
+    }
+    if (!hold_in_progress()) {
+        holding = false; // Expired: clear it before millis() wraps back into the window
+    }
+
+    if (closest < 0 || closest >= REFLEX_DIST_MM || speed_mm_s < REFLEX_MIN_SPEED_MM_S || reflex_active()) {
+        return;
+    }
+
+    // loop() sees the reflex at its next check and stops drawing and pushing
+    uint32_t detect_us = micros();
+    reflex_pending = true;
+
+    // Waits for at most one push chunk
+    reflex_display_lock();
+    present_closed_eyelids(REFLEX_EYELID_COLOR);
+    uint32_t present_us = micros();
+    hold_start_ms = millis();
+    holding = true;
+    reflex_pending = false;
+    reflex_display_unlock();
+
+    reflex_count++;
+    if (!from_interrupt) {
+        Serial.printf("Reflex #%u: %d mm at %.0f mm/s, polled frame, latency not measured\n",
+                      reflex_count, closest, speed_mm_s);
+        log_event(EVENT_REFLEX, closest, REFLEX_LATENCY_NOT_MEASURED);
+        return;
+    }
+
+    uint32_t detect_latency = detect_us - frame_time_us;
+    uint32_t present_latency = present_us - frame_time_us;
+    measured_count++;
+    detect_us_sum += detect_latency;
+    present_us_sum += present_latency;
+    detect_us_max = max(detect_us_max, detect_latency);
+    present_us_max = max(present_us_max, present_latency);
+
+    Serial.printf("Reflex #%u: %d mm at %.0f mm/s, detected %u us, eyelids closed %u us after the interrupt "
+                  "(detected max %u avg %u us, closed max %u avg %u us)%s\n",
+                  reflex_count, closest, speed_mm_s, detect_latency, present_latency,
+                  detect_us_max, detect_us_sum / measured_count, present_us_max, present_us_sum / measured_count,
+                  present_latency > REFLEX_LATENCY_BUDGET_US ? " OVER BUDGET" : "");
+    log_event(EVENT_REFLEX, closest, present_latency);
+}
+
+#else // REFLEX_ENABLED
+
+// Provide empty functions so the program compiles without the reflex.
+void init_reflex() { /* Does nothing */ }
+void reflex_on_sensor_frame(const VL53L5CX_ResultsData* data, uint32_t frame_time_us, bool from_interrupt) { /* Does nothing */ }
+bool reflex_active() {
+    return false;
+}
+unsigned long reflex_wait_hold() {
+    return 0;
+}
+void reflex_wait_flash_window() { /* Does nothing */ }
+void reflex_display_lock() { /* Does nothing */ }
+void reflex_display_unlock() { /* Does nothing */ }
+
+#endif // REFLEX_ENABLED
@@ -13,12 +13,270 @@
 #include <Wire.h>
 #include <cmath> // Pour fabsf
 #include "config.h" // Pour accéder à USE_TOF_SENSOR
+#include "event_log.h"
+#include "reflex.h"
 #if USE_TOF_SENSOR
 
+#if TOF_USE_MOTION_INDICATOR
+#include <vl53l5cx_plugin_motion_indicator.h>
+#ifdef VL53L5CX_DISABLE_MOTION_INDICATOR
+#error "TOF_USE_MOTION_INDICATOR needs the motion_indicator output of the VL53L5CX driver."
+#endif
+#endif
+#if TOF_USE_DETECTION_THRESHOLDS
+#include <vl53l5cx_plugin_detection_thresholds.h>
+#endif
+
 // --- ToF Sensor State (private to this file) ---
 static SparkFun_VL53L5CX myImager;
 static VL53L5CX_ResultsData measurementData; // Raw measurement data from the sensor
 static TofTarget current_target = {0, 0, 0, false, -1, -1, 0}; // The currently tracked target, initialized
+static TofTarget published_target = current_target; // Copy returned by get_tof_target(), see publish_target()
+static portMUX_TYPE target_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t consecutive_read_faults = 0; // Reset on the first successful read
+static unsigned long last_frame_time = 0;     // millis() of the last frame read, or of the last no-frame fault
+static unsigned long last_fault_log_time = 0;
+
+// --- Profiling (reported every TOF_STATS_INTERVAL_MS) ---
+static unsigned long stats_window_start = 0;
+static uint32_t stats_frames = 0;       // Frames read and processed in the window
+static uint32_t stats_polls = 0;        // isDataReady() calls in the window
+static uint32_t stats_poll_us = 0;      // Time spent in isDataReady() polls
+static uint32_t stats_read_us = 0;      // Time spent in I2C reads
+static uint32_t stats_processing_us = 0; // Time spent in process_measurement_data()
+
+#if TOF_USE_MOTION_INDICATOR || TOF_USE_DETECTION_THRESHOLDS
+// SparkFun_VL53L5CX does not wrap the ULD plugins and keeps its driver handle
+// private. An explicit template instantiation may name a private member, which
+// lets us fetch that handle without patching the library.
+typedef VL53L5CX_Configuration* SparkFun_VL53L5CX::*UldHandleMember;
+UldHandleMember uld_handle_member();
+template <UldHandleMember Member>
+struct UldHandleAccess {
+    friend UldHandleMember uld_handle_member() { return Member; }
+};
+template struct UldHandleAccess<&SparkFun_VL53L5CX::Dev>;
+
+static VL53L5CX_Configuration* uld_handle() {
+    return myImager.*uld_handle_member();
+}
+#endif
+
+#if TOF_USE_DETECTION_THRESHOLDS || REFLEX_ENABLED
+// --- Sensor interrupt (PIN_TOF_INT) ---
+static volatile bool tof_interrupt_pending = false; // Set by the PIN_TOF_INT ISR
+static volatile uint32_t tof_interrupt_time_us = 0; // micros() at the last interrupt
+#if REFLEX_ENABLED
+static TaskHandle_t sensor_task_handle = nullptr;
+#endif
+
+static void IRAM_ATTR on_tof_interrupt() {
+    tof_interrupt_time_us = micros(); // Before the flag, so a reader that sees the flag sees this time
+    tof_interrupt_pending = true;
+#if REFLEX_ENABLED
+    // Wake the sensor task right away; it preempts loop() if it shares its core.
+    if (sensor_task_handle) {
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(sensor_task_handle, &higher_priority_task_woken);
+        if (higher_priority_task_woken) {
+            portYIELD_FROM_ISR();
+        }
+    }
+#endif
+}
+
+static void attach_tof_interrupt() {
+    pinMode(PIN_TOF_INT, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(PIN_TOF_INT), on_tof_interrupt, FALLING);
+}
+#endif
+
+#if TOF_USE_DETECTION_THRESHOLDS
+// --- Sensor-side detection thresholds ---
+static unsigned long last_interrupt_time = 0;
+
+/**
+ * @brief Programs one distance threshold per zone so the sensor only pulls
+ * PIN_TOF_INT low when a zone sees something within MAX_DIST_TOF.
+ * Must be called before ranging starts.
+ */
+static void init_detection_thresholds() {
+    VL53L5CX_DetectionThresholds thresholds[VL53L5CX_NB_THRESHOLDS];
+    memset(thresholds, 0, sizeof(thresholds));
+
+    for (int zone = 0; zone < 64; zone++) {
+        thresholds[zone].zone_num = zone;
+        thresholds[zone].measurement = VL53L5CX_DISTANCE_MM;
+        thresholds[zone].type = VL53L5CX_IN_WINDOW;
+        // The lower bound keeps zones without a target (reported near 0 mm) from firing.
+        thresholds[zone].param_low_thresh = TOF_THRESHOLD_MIN_DIST_MM;
+        thresholds[zone].param_high_thresh = MAX_DIST_TOF;
+        thresholds[zone].mathematic_operation = VL53L5CX_OPERATION_NONE;
+    }
+    thresholds[63].zone_num = VL53L5CX_LAST_THRESHOLD | 63;
+
+    VL53L5CX_Configuration* dev = uld_handle();
+    uint8_t status = vl53l5cx_set_detection_thresholds(dev, thresholds);
+    status |= vl53l5cx_set_detection_thresholds_enable(dev, 1);
+    if (status != 0) {
+        Serial.printf("WARNING: VL53L5CX detection thresholds setup failed (status %d).\n", status);
+    }
+
+    Serial.printf("VL53L5CX detection thresholds enabled (%d-%d mm), waking on PIN_TOF_INT.\n",
+                  TOF_THRESHOLD_MIN_DIST_MM, MAX_DIST_TOF);
+}
+#endif
+
+#if TOF_USE_MOTION_INDICATOR
+// --- Sensor-side motion indicator ---
+static VL53L5CX_Motion_Configuration motion_config;
+// Center of each motion aggregate in zone coordinates, derived from motion_config.map_id.
+static float aggregate_center_row[32];
+static float aggregate_center_col[32];
+
+/**
+ * @brief Enables the sensor's motion indicator plugin for 8x8 ranging and
+ * precomputes the zone-space center of each motion aggregate.
+ * Must be called after the resolution is set and before ranging starts.
+ */
+static void init_motion_indicator() {
+    VL53L5CX_Configuration* dev = uld_handle();
+    uint8_t status = vl53l5cx_motion_indicator_init(dev, &motion_config, VL53L5CX_RESOLUTION_8X8);
+    status |= vl53l5cx_motion_indicator_set_distance_motion(dev, &motion_config,
+                                                           TOF_MOTION_MIN_DIST_MM, TOF_MOTION_MAX_DIST_MM);
+    if (status != 0) {
+        Serial.printf("WARNING: VL53L5CX motion indicator setup failed (status %d).\n", status);
+    }
+
+    int zone_count[32] = {0};
+    for (int i = 0; i < 32; i++) {
+        aggregate_center_row[i] = 0.0f;
+        aggregate_center_col[i] = 0.0f;
+    }
+    for (int zone = 0; zone < 64; zone++) {
+        int aggregate = motion_config.map_id[zone];
+        if (aggregate < 0 || aggregate >= 32) {
+            continue;
+        }
+        aggregate_center_row[aggregate] += zone / 8;
+        aggregate_center_col[aggregate] += zone % 8;
+        zone_count[aggregate]++;
+    }
+    for (int i = 0; i < 32; i++) {
+        if (zone_count[i] > 0) {
+            aggregate_center_row[i] /= zone_count[i];
+            aggregate_center_col[i] /= zone_count[i];
+        }
+    }
+    Serial.printf("VL53L5CX motion indicator enabled (%d-%d mm).\n", TOF_MOTION_MIN_DIST_MM, TOF_MOTION_MAX_DIST_MM);
+}
+
+/**
+ * @brief Picks the aggregate with the strongest sensor-reported motion.
+ * Used when no close target is found, so the eye still follows people moving
+ * beyond MAX_DIST_TOF without any frame differencing on the MCU.
+ * @return true if an aggregate exceeded TOF_MOTION_MIN_INDICATOR and the target was updated.
+ */
+static bool select_motion_target() {
+    const auto& motion = measurementData.motion_indicator;
+    if (motion.nb_of_detected_aggregates == 0) {
+        return false;
+    }
+
+    int best_aggregate = -1;
+    uint32_t best_motion = TOF_MOTION_MIN_INDICATOR;
+    for (int i = 0; i < motion.nb_of_aggregates && i < 32; i++) {
+        if (motion.motion[i] > best_motion) {
+            best_motion = motion.motion[i];
+            best_aggregate = i;
+        }
+    }
+    if (best_aggregate == -1) {
+        return false;
+    }
+
+    float row = aggregate_center_row[best_aggregate];
+    float col = aggregate_center_col[best_aggregate];
+    int pixel_y = (int)(row + 0.5f);
+    int pixel_x = (int)(col + 0.5f);
+
+    // Same axis convention as the distance-based target below
+    current_target.x = (row - 3.5f) / 3.5f;
+    current_target.y = (col - 3.5f) / 3.5f;
+    current_target.distance_mm = measurementData.distance_mm[pixel_y * 8 + pixel_x];
+    current_target.min_dist_pixel_x = pixel_x;
+    current_target.min_dist_pixel_y = pixel_y;
+    current_target.is_valid = true;
+    current_target.match_score = best_motion;
+    return true;
+}
+#endif
+
+/**
+ * @brief Counts a sensor fault and logs it. A persistent fault is logged on its
+ * first occurrence, then at most once per TOF_FAULT_LOG_INTERVAL_MS.
+ */
+static void record_sensor_fault(TofFaultCode code) {
+    consecutive_read_faults++;
+    unsigned long now = millis();
+    if (consecutive_read_faults == 1 || now - last_fault_log_time >= TOF_FAULT_LOG_INTERVAL_MS) {
+        log_event(EVENT_SENSOR_FAULT, code, consecutive_read_faults);
+        last_fault_log_time = now;
+    }
+}
+
+/**
+ * @brief Records a successfully read frame, logging the recovery if a fault was ongoing.
+ */
+static void record_sensor_frame() {
+    if (consecutive_read_faults > 0) {
+        log_event(EVENT_SENSOR_FAULT, TOF_FAULT_RECOVERED, consecutive_read_faults);
+        consecutive_read_faults = 0;
+    }
+    last_frame_time = millis();
+}
+
+/**
+ * @brief Prints the sensor bus and processing cost once per TOF_STATS_INTERVAL_MS,
+ * both per frame and per minute (the figure that matters while idle).
+ */
+static void log_tof_stats_if_due() {
+    unsigned long now = millis();
+    if (now - stats_window_start < TOF_STATS_INTERVAL_MS) {
+        return;
+    }
+    float minutes = (now - stats_window_start) / 60000.0f;
+    uint32_t bus_us = stats_poll_us + stats_read_us;
+    Serial.printf("ToF: %u frames, %u polls in %.1f min, I2C read avg %lu us, processing avg %lu us/frame (motion indicator %s)\n",
+                  stats_frames, stats_polls, minutes,
+                  stats_frames ? stats_read_us / stats_frames : 0UL,
+                  stats_frames ? stats_processing_us / stats_frames : 0UL,
+                  TOF_USE_MOTION_INDICATOR ? "on" : "off");
+    Serial.printf("ToF: bus %.1f ms/min, processing %.1f ms/min (detection thresholds %s)\n",
+                  bus_us / 1000.0f / minutes, stats_processing_us / 1000.0f / minutes,
+                  TOF_USE_DETECTION_THRESHOLDS ? "on" : "off");
+    stats_window_start = now;
+    stats_frames = 0;
+    stats_polls = 0;
+    stats_poll_us = 0;
+    stats_read_us = 0;
+    stats_processing_us = 0;
+}
+
+#if REFLEX_ENABLED
+static bool read_tof_sensor();
+
+/**
+ * @brief Owns the sensor when the blink reflex is enabled: sleeps until
+ * PIN_TOF_INT announces a frame, then reads and processes it immediately.
+ */
+static void tof_sensor_task(void* parameter) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(REFLEX_TASK_POLL_MS));
+        read_tof_sensor();
+    }
+}
+#endif
 
 /**
  * @brief Initializes the VL53L5CX ToF sensor.
@@ -38,7 +296,23 @@ void init_tof_sensor() {
 
   myImager.setResolution(8 * 8); // 64 zones de mesure
   myImager.setRangingFrequency(15); // 15 Hz
+  #if TOF_USE_MOTION_INDICATOR
+    init_motion_indicator();
+  #endif
+  #if TOF_USE_DETECTION_THRESHOLDS
+    init_detection_thresholds();
+  #endif
+  #if TOF_USE_DETECTION_THRESHOLDS || REFLEX_ENABLED
+    attach_tof_interrupt();
+  #endif
   myImager.startRanging();
+  last_frame_time = millis();
+
+  #if REFLEX_ENABLED
+    // From now on the sensor is only read by the sensor task
+    xTaskCreatePinnedToCore(tof_sensor_task, "tof_sensor", 4096, nullptr,
+                            REFLEX_TASK_PRIORITY, &sensor_task_handle, REFLEX_TASK_CORE);
+  #endif
 
   Serial.println("VL53L5CX Sensor Initialized.");
 }
@@ -150,6 +424,7 @@ static void log_measurement_matrix(const VL53L5CX_ResultsData* data) {
  * @param profile_start_time The start time for profiling purposes.
  */
 static void process_measurement_data(unsigned long profile_start_time) {
+    unsigned long processing_start_time = micros();
     const int MIN_RELIABLE_PIXELS_IN_WINDOW = 4; // Require at least 4 valid pixels in a 3x3 window to consider it a target.
     float best_avg_dist = 3.4028235E+38; // Initialize with FLT_MAX
     int best_target_index = -1;
@@ -206,42 +481,135 @@ static void process_measurement_data(unsigned long profile_start_time) {
         current_target.min_dist_pixel_y = pixel_y;
         current_target.is_valid = true;
         current_target.match_score = best_avg_dist;
-    } else {
+    }
+#if TOF_USE_MOTION_INDICATOR
+    else if (select_motion_target()) {
+        // Nothing close: follow the strongest motion reported by the sensor.
+    }
+#endif
+    else {
         // If no reliable target was found anywhere, invalidate the current target.
         current_target.is_valid = false;
         current_target.min_dist_pixel_x = -1;
         current_target.min_dist_pixel_y = -1;
         current_target.match_score = 0;
     }
+
+    unsigned long end_time = micros();
+    stats_frames++;
+    stats_processing_us += end_time - processing_start_time;
+    stats_read_us += processing_start_time - profile_start_time;
+}
+
+/**
+ * @brief Publishes current_target for get_tof_target(), which may run on
+ * another core than the sensor task.
+ */
+static void publish_target() {
+    portENTER_CRITICAL(&target_mux);
+    published_target = current_target;
+    portEXIT_CRITICAL(&target_mux);
 }
 
 /**
  * @brief Reads data from the ToF sensor and processes it.
+ * @return true if a new frame was read.
  */
-void update_tof_sensor_data() {
+static bool read_tof_sensor() {
+    bool new_frame = false;
 #if TOF_CALIBRATION_MODE
     // --- SIMULATION LOGIC FOR CALIBRATION ---
     run_calibration_simulation();
     // Analyze simulated data with the standard code
     process_measurement_data(micros());
+    new_frame = true;
 
 #else
+  #if TOF_USE_DETECTION_THRESHOLDS
+    // The sensor only interrupts when a zone is within MAX_DIST_TOF, so there
+    // is no I2C traffic at all until something approaches.
+    if (!tof_interrupt_pending) {
+      if (current_target.is_valid && millis() - last_interrupt_time > TOF_THRESHOLD_RELEASE_MS) {
+        // No zone has crossed the threshold for a while: the target has left.
+        current_target.is_valid = false;
+        current_target.min_dist_pixel_x = -1;
+        current_target.min_dist_pixel_y = -1;
+        current_target.match_score = 0;
+      }
+      publish_target();
+      log_tof_stats_if_due();
+      return false;
+    }
+    tof_interrupt_pending = false;
+    last_interrupt_time = millis();
+  #endif
+
+  #if REFLEX_ENABLED
+    // The sensor task also reads on its poll timeout: only a frame announced by
+    // the interrupt has a known start time for the reflex latency.
+    #if TOF_USE_DETECTION_THRESHOLDS
+      bool frame_from_interrupt = true; // Consumed above
+    #else
+      bool frame_from_interrupt = tof_interrupt_pending;
+      tof_interrupt_pending = false;
+    #endif
+    uint32_t interrupt_time_us = tof_interrupt_time_us;
+  #endif
+
   // Run detection logic only when new data is available
-  if (myImager.isDataReady()) {
+  unsigned long poll_start_time = micros();
+  bool data_ready = myImager.isDataReady();
+  stats_polls++;
+  stats_poll_us += micros() - poll_start_time;
+  if (data_ready) {
     unsigned long profile_start_time = micros();
     if (myImager.getRangingData(&measurementData)) {
+        record_sensor_frame();
+        new_frame = true;
         process_measurement_data(profile_start_time);
+      #if REFLEX_ENABLED
+        reflex_on_sensor_frame(&measurementData, frame_from_interrupt ? interrupt_time_us : profile_start_time,
+                               frame_from_interrupt);
+      #endif
+    } else {
+        record_sensor_fault(TOF_FAULT_READ_FAILED);
     }
   }
+  #if !TOF_USE_DETECTION_THRESHOLDS
+    // isDataReady() also returns false when the bus is down. With detection thresholds
+    // the sensor is silent by design while nothing is close, so there is no timeout.
+    if (!data_ready && millis() - last_frame_time > TOF_FAULT_NO_FRAME_TIMEOUT_MS) {
+        record_sensor_fault(TOF_FAULT_NO_FRAME);
+        last_frame_time = millis(); // Counts one fault per timeout period
+    }
+  #endif
+#endif
+  publish_target();
+  log_tof_stats_if_due();
+  return new_frame;
+}
+
+/**
+ * @brief Reads data from the ToF sensor and processes it.
+ * With the blink reflex, the sensor task does this as soon as a frame is ready.
+ */
+void update_tof_sensor_data() {
+#if !REFLEX_ENABLED
+    read_tof_sensor();
 #endif
 }
 
 TofTarget get_tof_target() {
-    return current_target;
+    portENTER_CRITICAL(&target_mux);
+    TofTarget target = published_target;
+    portEXIT_CRITICAL(&target_mux);
+    return target;
 }
 
 /**
  * @brief Returns a pointer to the raw measurement data structure.
+ * With the blink reflex it may be overwritten by the sensor task while it is
+ * read; it is only used by the debug grid.
  */
 const VL53L5CX_ResultsData* get_tof_measurement_data() {
     return &measurementData;
@@ -0,0 +1,196 @@
+"""
+Decodes the binary session event log written by the firmware (events.bin / events.old.bin)
+and prints the records and a per-session summary.
+The format is defined in firmware/include/event_log.h.
+
+Usage:
+    python log_tools/decode_event_log.py events.old.bin events.bin
+    python log_tools/decode_event_log.py --summary-only events.bin
+    python log_tools/decode_event_log.py --capture monitor_output.txt
+
+A capture is the Serial monitor output saved after sending 'L' to the firmware.
+"""
+
+import argparse
+import struct
+import sys
+
+# --- Format (keep in sync with firmware/include/event_log.h) ---
+EVENT_LOG_MAGIC = 0x474C5645  # "EVLG"
+EVENT_LOG_VERSION = 1
+BATCH_HEADER = struct.Struct("<IBBHII")  # magic, version, record_size, record_count, sequence, dropped
+RECORD = struct.Struct("<IBBhi")         # timestamp_ms, type, reserved, value_a, value_b
+
+REFLEX_LATENCY_NOT_MEASURED = -1
+TOF_FAULT_RECOVERED = 3
+TOF_FAULT_NAMES = {1: "read_failed", 2: "no_frame", TOF_FAULT_RECOVERED: "recovered"}  # TofFaultCode
+
+EVENT_NAMES = [
+    "BOOT",
+    "TARGET_ACQUIRED",
+    "TARGET_LOST",
+    "FPS_REPORT",
+    "FPS_DIP",
+    "SENSOR_FAULT",
+    "REFLEX",
+]
+
+
+def load_log_files(paths, capture):
+    """
+    Returns a list of (name, bytes) for the log files to decode, oldest first.
+
+    Args:
+        paths: Paths to binary log files.
+        capture: True if the paths are Serial monitor captures containing
+                 EVENTLOG-BEGIN / EVENTLOG-END hex blocks.
+    """
+    files = []
+    for path in paths:
+        if not capture:
+            with open(path, "rb") as f:
+                files.append((path, f.read()))
+            continue
+
+        name, hex_lines = None, []
+        with open(path, "r", errors="replace") as f:
+            for line in f:
+                line = line.strip()
+                if line.startswith("EVENTLOG-BEGIN"):
+                    name, hex_lines = line.split()[1], []
+                elif line.startswith("EVENTLOG-END") and name is not None:
+                    files.append((name, bytes.fromhex("".join(hex_lines))))
+                    name = None
+                elif name is not None:
+                    hex_lines.append(line)
+    return files
+
+
+def read_batches(path, data):
+    """
+    Yields (header, records) tuples from the contents of a log file.
+    Skips forward to the next magic number when a batch is corrupt or torn.
+
+    Args:
+        path: Name of the log file, for messages.
+        data: The file contents.
+    """
+    magic_bytes = struct.pack("<I", EVENT_LOG_MAGIC)
+    offset = 0
+    while offset + BATCH_HEADER.size <= len(data):
+        magic, version, record_size, record_count, sequence, dropped = BATCH_HEADER.unpack_from(data, offset)
+        end = offset + BATCH_HEADER.size + record_count * record_size
+        if magic != EVENT_LOG_MAGIC or record_size < RECORD.size or end > len(data):
+            next_offset = data.find(magic_bytes, offset + 1)
+            if next_offset < 0:
+                print(f"{path}: {len(data) - offset} trailing bytes could not be decoded", file=sys.stderr)
+                return
+            print(f"{path}: skipped {next_offset - offset} corrupt bytes at offset {offset}", file=sys.stderr)
+            offset = next_offset
+            continue
+
+        records = []
+        record_offset = offset + BATCH_HEADER.size
+        for _ in range(record_count):
+            records.append(RECORD.unpack_from(data, record_offset))
+            record_offset += record_size
+        yield {"version": version, "sequence": sequence, "dropped": dropped}, records
+        offset = end
+
+
+def format_record(timestamp_ms, event_type, value_a, value_b):
+    """
+    Returns a human-readable line for one record.
+    """
+    name = EVENT_NAMES[event_type] if event_type < len(EVENT_NAMES) else f"UNKNOWN({event_type})"
+    if name == "BOOT":
+        detail = f"free_heap={value_b} B"
+    elif name == "TARGET_ACQUIRED":
+        detail = f"distance={value_a} mm zone=({value_b // 8},{value_b % 8})"
+    elif name == "TARGET_LOST":
+        detail = f"tracked_for={value_b / 1000.0:.1f} s"
+    elif name == "FPS_REPORT":
+        detail = f"avg_fps={value_a / 10.0:.1f} frames={value_b}"
+    elif name == "FPS_DIP":
+        detail = f"fps={value_a / 10.0:.1f} threshold={value_b / 10.0:.1f}"
+    elif name == "SENSOR_FAULT":
+        detail = f"{TOF_FAULT_NAMES.get(value_a, f'code={value_a}')} consecutive={value_b}"
+    elif name == "REFLEX":
+        latency = "not measured" if value_b == REFLEX_LATENCY_NOT_MEASURED else f"{value_b / 1000.0:.1f} ms"
+        detail = f"distance={value_a} mm latency={latency}"
+    else:
+        detail = f"a={value_a} b={value_b}"
+    return f"{timestamp_ms / 1000.0:10.3f} s  {name:<16} {detail}"
+
+
+def new_session():
+    return {"targets": 0, "tracked_ms": 0, "fps_dips": 0, "min_fps": None,
+            "fps_reports": [], "sensor_faults": 0, "reflexes": 0, "max_reflex_us": 0, "last_ms": 0}
+
+
+def print_session(index, session):
+    avg_fps = sum(session["fps_reports"]) / len(session["fps_reports"]) if session["fps_reports"] else 0.0
+    min_fps = f"{session['min_fps']:.1f}" if session["min_fps"] is not None else "-"
+    print(f"Session {index}: up {session['last_ms'] / 60000.0:.1f} min, "
+          f"{session['targets']} targets tracked ({session['tracked_ms'] / 1000.0:.1f} s total), "
+          f"avg FPS {avg_fps:.1f}, {session['fps_dips']} FPS dips (min {min_fps}), "
+          f"{session['sensor_faults']} sensor faults, "
+          f"{session['reflexes']} reflexes (max latency {session['max_reflex_us'] / 1000.0:.1f} ms)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode the firmware session event log.")
+    parser.add_argument("files", nargs="+", help="Log files, oldest first (e.g. events.old.bin events.bin)")
+    parser.add_argument("--capture", action="store_true", help="Inputs are Serial monitor captures of a log dump")
+    parser.add_argument("--summary-only", action="store_true", help="Print only the per-session summary")
+    args = parser.parse_args()
+
+    sessions = []
+    session = None
+    dropped_total = 0
+    last_sequence = None
+    for path, data in load_log_files(args.files, args.capture):
+        for header, records in read_batches(path, data):
+            if last_sequence is not None and header["sequence"] != last_sequence + 1:
+                print(f"-- batch sequence jumps from {last_sequence} to {header['sequence']} --", file=sys.stderr)
+            last_sequence = header["sequence"]
+            dropped_total += header["dropped"]
+            if header["dropped"] and not args.summary_only:
+                print(f"-- {header['dropped']} records dropped before batch {header['sequence']} --")
+
+            for timestamp_ms, event_type, _, value_a, value_b in records:
+                name = EVENT_NAMES[event_type] if event_type < len(EVENT_NAMES) else None
+                if name == "BOOT" or session is None:
+                    session = new_session()
+                    sessions.append(session)
+                session["last_ms"] = timestamp_ms
+                if name == "TARGET_ACQUIRED":
+                    session["targets"] += 1
+                elif name == "TARGET_LOST":
+                    session["tracked_ms"] += value_b
+                elif name == "FPS_REPORT":
+                    session["fps_reports"].append(value_a / 10.0)
+                elif name == "FPS_DIP":
+                    session["fps_dips"] += 1
+                    fps = value_a / 10.0
+                    if session["min_fps"] is None or fps < session["min_fps"]:
+                        session["min_fps"] = fps
+                elif name == "SENSOR_FAULT" and value_a != TOF_FAULT_RECOVERED:
+                    session["sensor_faults"] += 1
+                elif name == "REFLEX":
+                    session["reflexes"] += 1
+                    session["max_reflex_us"] = max(session["max_reflex_us"], value_b)
+
+                if not args.summary_only:
+                    print(format_record(timestamp_ms, event_type, value_a, value_b))
+
+    if not args.summary_only:
+        print()
+    for index, s in enumerate(sessions):
+        print_session(index, s)
+    if dropped_total:
+        print(f"{dropped_total} records were dropped by the firmware (RAM buffers full)")
+
+
+if __name__ == "__main__":
+    main()